@@ -0,0 +1,287 @@
+#include "FrameArchive.h"
+
+#include <QDebug>
+#include <QStorageInfo>
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+
+#if defined(Q_OS_LINUX)
+#include <cerrno>
+#include <fcntl.h>
+#endif
+
+static const char magic[8] = { 'Q', 'M', 'R', 'F', 'R', 'A', 'M', 'E' };
+static const quint32 version = 1;
+static const qint64 headerSize = 64;
+static const qint64 indexEntrySize = 16;
+static const qint64 pageSize = 4096;
+// QImage's limit, also keeps width * height * 4 far from overflowing
+static const quint32 maxEdge = 32767;
+
+static qint64 alignToPage(qint64 size)
+{
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+// Writing to a mapped page the disk has no room for raises SIGBUS, so the
+// blocks are reserved before the file is mapped.
+static bool allocateFile(QFile& file, qint64 size)
+{
+#if defined(Q_OS_LINUX)
+    const int error = posix_fallocate(file.handle(), 0, size);
+    if (error == 0)
+        return true;
+    // File systems without it fall back to the free space check.
+    if (error != EOPNOTSUPP && error != EINVAL) {
+        qWarning() << "FrameArchive: Unable to allocate" << size << "bytes for" << file.fileName() << strerror(error);
+        return false;
+    }
+#endif
+    const QStorageInfo storage(file.fileName());
+    if (storage.isValid() && storage.bytesAvailable() < size) {
+        qWarning() << "FrameArchive: Not enough space for" << file.fileName() << "needs" << size << "bytes, available"
+                   << storage.bytesAvailable();
+        return false;
+    }
+    return file.resize(size);
+}
+
+FrameArchive::~FrameArchive()
+{
+    close();
+}
+
+bool FrameArchive::isArchiveFormat(const QString& outputFormat)
+{
+    return outputFormat == "archive" || outputFormat == "archivez";
+}
+
+FrameArchive::Compression FrameArchive::compression(const QString& outputFormat)
+{
+    return outputFormat == "archivez" ? Compression::Zlib : Compression::None;
+}
+
+bool FrameArchive::create(const QString& fileName, const QSize& size, int firstFrame, int frameCount, const FrameRate& frameRate, Compression compression)
+{
+    close();
+    m_size = size;
+    m_firstFrame = firstFrame;
+    m_frameCount = qMax(0, frameCount);
+    m_frameRate = frameRate;
+    m_compression = compression;
+    m_slotSize = alignToPage(qint64(size.width()) * size.height() * 4);
+    m_dataOffset = alignToPage(headerSize + indexEntrySize * m_frameCount);
+    m_bytesWritten = 0;
+    m_writable = true;
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qWarning() << "FrameArchive: Unable to open:" << fileName << m_file.errorString();
+        return false;
+    }
+    const qint64 fileSize = m_dataOffset + m_slotSize * m_frameCount;
+    if (!allocateFile(m_file, fileSize) || !map(fileSize)) {
+        m_file.remove();
+        return false;
+    }
+
+    // The index is zero, every frame is missing until written.
+    memcpy(m_data, magic, sizeof(magic));
+    qToLittleEndian<quint32>(version, m_data + 8);
+    qToLittleEndian<quint32>(size.width(), m_data + 12);
+    qToLittleEndian<quint32>(size.height(), m_data + 16);
+    qToLittleEndian<quint32>(firstFrame, m_data + 20);
+    qToLittleEndian<quint32>(m_frameCount, m_data + 24);
+    qToLittleEndian<quint32>(quint32(compression), m_data + 28);
+    qToLittleEndian<quint64>(frameRate.numerator, m_data + 32);
+    qToLittleEndian<quint64>(frameRate.denominator, m_data + 40);
+    qToLittleEndian<quint64>(m_slotSize, m_data + 48);
+    return true;
+}
+
+bool FrameArchive::open(const QString& fileName)
+{
+    close();
+    m_writable = false;
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "FrameArchive: Unable to open:" << fileName << m_file.errorString();
+        return false;
+    }
+    if (m_file.size() < headerSize || !map(m_file.size()))
+        return false;
+    if (memcmp(m_data, magic, sizeof(magic)) != 0 || qFromLittleEndian<quint32>(m_data + 8) != version) {
+        qWarning() << "FrameArchive: Not a frame archive:" << fileName;
+        close();
+        return false;
+    }
+
+    const quint32 width = qFromLittleEndian<quint32>(m_data + 12);
+    const quint32 height = qFromLittleEndian<quint32>(m_data + 16);
+    m_firstFrame = qFromLittleEndian<quint32>(m_data + 20);
+    m_frameCount = qFromLittleEndian<quint32>(m_data + 24);
+    m_compression = Compression(qFromLittleEndian<quint32>(m_data + 28));
+    m_frameRate.numerator = qFromLittleEndian<quint64>(m_data + 32);
+    m_frameRate.denominator = qFromLittleEndian<quint64>(m_data + 40);
+    m_slotSize = qFromLittleEndian<quint64>(m_data + 48);
+    // The header is untrusted. Every factor is bounded by the file size before
+    // it is multiplied, so the checks themselves cannot overflow.
+    const qint64 fileSize = m_file.size();
+    if (width == 0 || width > maxEdge || height == 0 || height > maxEdge || m_firstFrame < 0 || m_frameCount < 0
+        || m_frameCount > std::numeric_limits<int>::max() - m_firstFrame || m_frameCount > (fileSize - headerSize) / indexEntrySize
+        || m_slotSize < alignToPage(qint64(width) * height * 4)) {
+        qWarning() << "FrameArchive: Corrupt header:" << fileName;
+        close();
+        return false;
+    }
+    m_size = QSize(width, height);
+    m_dataOffset = alignToPage(headerSize + indexEntrySize * m_frameCount);
+    if (m_dataOffset > fileSize || (m_frameCount > 0 && m_slotSize > (fileSize - m_dataOffset) / m_frameCount)) {
+        qWarning() << "FrameArchive: Truncated archive:" << fileName;
+        close();
+        return false;
+    }
+    // Linked frames share the slot of another frame, only slots are counted.
+    m_bytesWritten = 0;
+    for (int frame = m_firstFrame; frame < m_firstFrame + m_frameCount; ++frame) {
+        if (qint64(qFromLittleEndian<quint64>(indexEntry(frame))) == slotOffset(frame))
+            m_bytesWritten += qFromLittleEndian<quint32>(indexEntry(frame) + 8);
+    }
+    return true;
+}
+
+void FrameArchive::close()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_file.close();
+}
+
+bool FrameArchive::map(qint64 size)
+{
+    m_data = m_file.map(0, size);
+    if (!m_data) {
+        qWarning() << "FrameArchive: Unable to map:" << m_file.fileName() << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+uchar* FrameArchive::indexEntry(int frameNumber) const
+{
+    return m_data + headerSize + indexEntrySize * (frameNumber - m_firstFrame);
+}
+
+qint64 FrameArchive::slotOffset(int frameNumber) const
+{
+    return m_dataOffset + m_slotSize * (frameNumber - m_firstFrame);
+}
+
+qint64 FrameArchive::writeFrame(int frameNumber, const QImage& image)
+{
+    if (!m_writable || !m_data || frameNumber < m_firstFrame || frameNumber >= m_firstFrame + m_frameCount) {
+        qWarning() << "FrameArchive: Frame" << frameNumber << "is not part of the archive";
+        return -1;
+    }
+    if (image.size() != m_size) {
+        qWarning() << "FrameArchive: Frame size" << image.size() << "does not match" << m_size;
+        return -1;
+    }
+    QImage frame = image;
+    if (frame.format() != QImage::Format_RGBA8888_Premultiplied)
+        frame.convertTo(QImage::Format_RGBA8888_Premultiplied);
+
+    const qint64 offset = slotOffset(frameNumber);
+    uchar* slot = m_data + offset;
+    const qsizetype stride = qsizetype(m_size.width()) * 4;
+    const qsizetype rawSize = stride * m_size.height();
+    Compression compression = Compression::None;
+    qint64 storedSize = rawSize;
+
+    if (m_compression == Compression::Zlib) {
+        // A 4 byte multiple, so the rows of a QImage are contiguous.
+        const QByteArray compressed = qCompress(frame.constBits(), rawSize, 1);
+        // Incompressible frames are stored raw.
+        if (compressed.size() < rawSize) {
+            memcpy(slot, compressed.constData(), compressed.size());
+            compression = Compression::Zlib;
+            storedSize = compressed.size();
+        }
+    }
+    if (compression == Compression::None) {
+        for (int y = 0; y < m_size.height(); ++y)
+            memcpy(slot + y * stride, frame.constScanLine(y), stride);
+    }
+
+    // The size goes in last, a frame only counts once its pixels are there.
+    uchar* entry = indexEntry(frameNumber);
+    // A rewritten slot replaces its previous pixels, a previous link used another slot.
+    const qint64 previousSize = qint64(qFromLittleEndian<quint64>(entry)) == offset ? qFromLittleEndian<quint32>(entry + 8) : 0;
+    qToLittleEndian<quint64>(offset, entry);
+    qToLittleEndian<quint32>(quint32(compression), entry + 12);
+    qToLittleEndian<quint32>(quint32(storedSize), entry + 8);
+    m_bytesWritten += storedSize - previousSize;
+    return storedSize;
+}
+
+bool FrameArchive::linkFrame(int frameNumber, int sourceFrame)
+{
+    if (!m_writable || !hasFrame(sourceFrame) || frameNumber < m_firstFrame || frameNumber >= m_firstFrame + m_frameCount) {
+        qWarning() << "FrameArchive: Unable to link frame" << frameNumber << "to" << sourceFrame;
+        return false;
+    }
+    memcpy(indexEntry(frameNumber), indexEntry(sourceFrame), indexEntrySize);
+    return true;
+}
+
+bool FrameArchive::hasFrame(int frameNumber) const
+{
+    if (!m_data || frameNumber < m_firstFrame || frameNumber >= m_firstFrame + m_frameCount)
+        return false;
+    return qFromLittleEndian<quint32>(indexEntry(frameNumber) + 8) > 0;
+}
+
+qint64 FrameArchive::frameOffset(int frameNumber) const
+{
+    return hasFrame(frameNumber) ? qint64(qFromLittleEndian<quint64>(indexEntry(frameNumber))) : -1;
+}
+
+QImage FrameArchive::readFrame(int frameNumber) const
+{
+    if (!hasFrame(frameNumber))
+        return QImage();
+    const uchar* entry = indexEntry(frameNumber);
+    const qint64 offset = qFromLittleEndian<quint64>(entry);
+    const qint64 storedSize = qFromLittleEndian<quint32>(entry + 8);
+    const Compression compression = Compression(qFromLittleEndian<quint32>(entry + 12));
+    if (offset < m_dataOffset || storedSize > m_file.size() - offset) {
+        qWarning() << "FrameArchive: Corrupt index entry of frame" << frameNumber;
+        return QImage();
+    }
+
+    QImage image(m_size, QImage::Format_RGBA8888_Premultiplied);
+    if (image.isNull()) {
+        qWarning() << "FrameArchive: Unable to allocate frame" << frameNumber;
+        return QImage();
+    }
+    const qsizetype rawSize = qsizetype(m_size.width()) * 4 * m_size.height();
+    if (compression == Compression::Zlib) {
+        const QByteArray pixels = qUncompress(m_data + offset, storedSize);
+        // Also rejects a size prefix that does not match the frame.
+        if (pixels.size() != rawSize) {
+            qWarning() << "FrameArchive: Unable to decompress frame" << frameNumber;
+            return QImage();
+        }
+        memcpy(image.bits(), pixels.constData(), rawSize);
+    } else if (compression == Compression::None && storedSize == rawSize) {
+        memcpy(image.bits(), m_data + offset, rawSize);
+    } else {
+        qWarning() << "FrameArchive: Corrupt index entry of frame" << frameNumber;
+        return QImage();
+    }
+    return image;
+}
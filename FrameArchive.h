@@ -0,0 +1,78 @@
+#pragma once
+
+#include "animationdriver.h"
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <atomic>
+
+// All frames of a job in one file instead of one image file per frame, which
+// spares network file systems tens of thousands of creates. The file is
+// allocated up front and memory mapped, create() fails when the disk cannot hold
+// it. The encoder workers write each frame straight into its own slot, in any
+// order and in parallel.
+// Layout, little endian:
+//  - header, 64 bytes: "QMRFRAME", version, width, height, first frame,
+//    frame count, compression, frame rate numerator and denominator, slot size
+//  - index, 16 bytes per frame: offset, stored size (0 while missing), compression
+//  - slots, page aligned: premultiplied rgba rows, top-down, raw or zlib (qCompress)
+// Repeated frames share a slot, their index entries hold the same offset.
+class FrameArchive {
+public:
+    enum class Compression : quint32 {
+        None = 0,
+        Zlib = 1,
+    };
+
+    FrameArchive() = default;
+    ~FrameArchive();
+
+    // "archive" stores raw frames, "archivez" zlib compressed ones at level 1.
+    static bool isArchiveFormat(const QString& outputFormat);
+    static Compression compression(const QString& outputFormat);
+    static QString fileSuffix() { return QStringLiteral("frames"); }
+
+    // Frame numbers run from firstFrame to firstFrame + frameCount - 1.
+    bool create(const QString& fileName, const QSize& size, int firstFrame, int frameCount, const FrameRate& frameRate, Compression compression);
+    bool open(const QString& fileName);
+    void close();
+    bool isOpen() const { return m_data; }
+
+    // Thread safe for different frames. Returns the stored size or -1.
+    qint64 writeFrame(int frameNumber, const QImage& image);
+    // Points frameNumber at the slot of sourceFrame, which must already be written.
+    bool linkFrame(int frameNumber, int sourceFrame);
+
+    bool hasFrame(int frameNumber) const;
+    // Frames with the same offset share their pixels.
+    qint64 frameOffset(int frameNumber) const;
+    // Format_RGBA8888_Premultiplied, null for missing frames.
+    QImage readFrame(int frameNumber) const;
+
+    QSize size() const { return m_size; }
+    int firstFrame() const { return m_firstFrame; }
+    int frameCount() const { return m_frameCount; }
+    FrameRate frameRate() const { return m_frameRate; }
+    Compression compression() const { return m_compression; }
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+private:
+    uchar* indexEntry(int frameNumber) const;
+    // Where the frame's own slot starts, linked frames point elsewhere.
+    qint64 slotOffset(int frameNumber) const;
+    bool map(qint64 size);
+
+private:
+    QFile m_file;
+    uchar* m_data = nullptr;
+    bool m_writable = false;
+    QSize m_size;
+    int m_firstFrame = 0;
+    int m_frameCount = 0;
+    FrameRate m_frameRate;
+    Compression m_compression = Compression::None;
+    qint64 m_slotSize = 0;
+    qint64 m_dataOffset = 0;
+    std::atomic<qint64> m_bytesWritten = 0;
+};
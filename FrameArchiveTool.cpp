@@ -0,0 +1,145 @@
+// Copyright (C) The Qt Company Ltd.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+
+#include "FrameArchive.h"
+#include "FrameEncoder.h"
+#include "FrameStream.h"
+#include "ImageEncoder.h"
+
+// Prints the header of a frame archive and which frames it holds.
+static int printInfo(const FrameArchive& archive)
+{
+    int frames = 0;
+    int shared = 0;
+    QSet<qint64> offsets;
+    for (int frame = archive.firstFrame(); frame < archive.firstFrame() + archive.frameCount(); ++frame) {
+        if (!archive.hasFrame(frame))
+            continue;
+        frames++;
+        if (offsets.contains(archive.frameOffset(frame)))
+            shared++;
+        offsets.insert(archive.frameOffset(frame));
+    }
+    qInfo().noquote() << QString("%1x%2, %3/%4 fps, frames %5 to %6, %7")
+                             .arg(archive.size().width())
+                             .arg(archive.size().height())
+                             .arg(archive.frameRate().numerator)
+                             .arg(archive.frameRate().denominator)
+                             .arg(archive.firstFrame())
+                             .arg(archive.firstFrame() + archive.frameCount() - 1)
+                             .arg(archive.compression() == FrameArchive::Compression::Zlib ? "zlib" : "raw");
+    qInfo().noquote() << QString("%1 frames stored, %2 of them sharing a slot, %3 missing, %4 MB of pixels")
+                             .arg(frames)
+                             .arg(shared)
+                             .arg(archive.frameCount() - frames)
+                             .arg(archive.bytesWritten() / 1e6, 0, 'f', 1);
+    return 0;
+}
+
+// Image sequences are written as <name>_<frame>.<format> like a render job,
+// frames sharing a slot with the previous one are hard linked. y4m and rgba
+// go into a single <name>.<format> stream.
+static int extract(const FrameArchive& archive, const QString& outputDirectory, const QString& name, const QString& outputFormat, int threads)
+{
+    QString format;
+    ImageEncoder::Options imageOptions;
+    if (!ImageEncoder::parseFormat(outputFormat, &format, &imageOptions))
+        return 1;
+    if (!QDir().mkpath(outputDirectory)) {
+        qWarning() << "Unable to create" << outputDirectory;
+        return 1;
+    }
+
+    FrameEncoder encoder;
+    encoder.setWorkerCount(threads);
+    encoder.setMaxQueueDepth(2 * threads);
+    encoder.setImageOptions(imageOptions);
+
+    FrameStream stream;
+    const bool streamed = FrameStream::isStreamFormat(format);
+    if (streamed) {
+        if (format == "pipe") {
+            qWarning("Extract to y4m and pipe the file instead");
+            return 1;
+        }
+        const QString streamFile = QDir(outputDirectory).filePath(name + "." + format);
+        if (!stream.open(format, streamFile, QString(), archive.size(), archive.frameRate()))
+            return 1;
+        encoder.setStream(&stream);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QImage::Format imageFormat = FrameEncoder::preferredImageFormat(format);
+    int missing = 0;
+    QImage image;
+    QStringList outputFiles;
+    qint64 offset = -1;
+    for (int frame = archive.firstFrame(); frame < archive.firstFrame() + archive.frameCount(); ++frame) {
+        if (!archive.hasFrame(frame)) {
+            missing++;
+            continue;
+        }
+        const QString outputFile = streamed ? QString() : QDir(outputDirectory).filePath(name + "_" + QString::number(frame) + "." + format);
+        // Decode shared slots once.
+        if (archive.frameOffset(frame) == offset) {
+            outputFiles.append(outputFile);
+            continue;
+        }
+        if (!outputFiles.isEmpty())
+            encoder.enqueue(image, outputFiles);
+        image = archive.readFrame(frame);
+        if (image.isNull())
+            return 1;
+        image.convertTo(imageFormat);
+        offset = archive.frameOffset(frame);
+        outputFiles = { outputFile };
+    }
+    if (!outputFiles.isEmpty())
+        encoder.enqueue(image, outputFiles);
+    encoder.waitForFinished();
+    encoder.setStream(nullptr);
+
+    if (missing > 0)
+        qWarning() << missing << "frames were never written to the archive";
+    qInfo().noquote() << QString("Extracted %1 frames in %2 ms").arg(encoder.encodedFrames()).arg(timer.elapsed());
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Lists or extracts the frames of a .frames archive written with the archive or archivez output format.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "info or extract");
+    parser.addPositionalArgument("archive", "The .frames file");
+    const QCommandLineOption outputOption({ "o", "output" }, "Output directory.", "directory", ".");
+    const QCommandLineOption nameOption("name", "Output file name, defaults to the archive's name.", "name");
+    const QCommandLineOption formatOption("format", "Image format of the sequence, with options like png?level=1, or y4m/rgba for a single stream.", "format", "png");
+    const QCommandLineOption threadsOption("threads", "Encoder threads.", "count", QString::number(QThread::idealThreadCount()));
+    parser.addOptions({ outputOption, nameOption, formatOption, threadsOption });
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 2 || (arguments[0] != "info" && arguments[0] != "extract"))
+        parser.showHelp(1);
+
+    FrameArchive archive;
+    if (!archive.open(arguments[1]))
+        return 1;
+    if (arguments[0] == "info")
+        return printInfo(archive);
+
+    const QString name = parser.isSet(nameOption) ? parser.value(nameOption) : QFileInfo(arguments[1]).completeBaseName();
+    return extract(archive, parser.value(outputOption), name, parser.value(formatOption), qMax(1, parser.value(threadsOption).toInt()));
+}
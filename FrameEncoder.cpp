@@ -0,0 +1,258 @@
+#include "FrameEncoder.h"
+#include "FrameHash.h"
+
+#include <QBuffer>
+#include <QCollator>
+#include <QFile>
+#include <QFileInfo>
+#include <filesystem>
+
+FrameEncoder::FrameEncoder(QObject* parent)
+    : QObject(parent)
+{
+    setWorkerCount(QThread::idealThreadCount());
+    setMaxQueueDepth(2 * m_workerCount);
+}
+
+FrameEncoder::~FrameEncoder()
+{
+    waitForFinished();
+}
+
+void FrameEncoder::setWorkerCount(int workerCount)
+{
+    m_workerCount = qMax(1, workerCount);
+    m_pool.setMaxThreadCount(m_stream ? 1 : m_workerCount);
+}
+
+void FrameEncoder::setStream(FrameStream* stream)
+{
+    waitForFinished();
+    m_stream = stream;
+    m_pool.setMaxThreadCount(m_stream ? 1 : m_workerCount);
+}
+
+void FrameEncoder::setArchive(FrameArchive* archive)
+{
+    waitForFinished();
+    m_archive = archive;
+}
+
+void FrameEncoder::setMaxQueueDepth(int maxQueueDepth)
+{
+    // Only resize the semaphore while no frame holds a slot.
+    waitForFinished();
+    m_freeSlots.acquire(m_maxQueueDepth);
+    m_maxQueueDepth = qMax(1, maxQueueDepth);
+    m_freeSlots.release(m_maxQueueDepth);
+}
+
+void FrameEncoder::reset()
+{
+    waitForFinished();
+    m_encodedFrames = 0;
+    m_duplicateFrames = 0;
+    m_hashFiles.clear();
+    m_hashIndex.clear();
+}
+
+void FrameEncoder::setDeduplicate(bool deduplicate)
+{
+    waitForFinished();
+    m_deduplicate = deduplicate;
+}
+
+bool FrameEncoder::writeHashIndex(const QString& fileName)
+{
+    waitForFinished();
+
+    QList<HashEntry> entries = m_hashIndex;
+    if (!m_stream) {
+        // Workers finish out of order, "name_10" sorts after "name_9".
+        QCollator collator;
+        collator.setNumericMode(true);
+        std::sort(entries.begin(), entries.end(), [&collator](const HashEntry& a, const HashEntry& b) {
+            return collator.compare(a.file, b.file) < 0;
+        });
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "Unable to save:" << fileName << file.errorString();
+        return false;
+    }
+    for (qsizetype i = 0; i < entries.size(); ++i) {
+        const HashEntry& entry = entries.at(i);
+        QString line = (m_stream ? QString::number(i) : QFileInfo(entry.file).fileName()) + " " + FrameHash::toString(entry.hash);
+        if (!entry.source.isEmpty())
+            line += " " + QFileInfo(entry.source).fileName();
+        file.write(line.toUtf8() + '\n');
+    }
+    return true;
+}
+
+QString FrameEncoder::registerFrame(quint64 hash, const QStringList& outputFiles)
+{
+    QMutexLocker lock(&m_hashMutex);
+    // Streams keep every frame, there the hashes only fingerprint the output.
+    const QString source = m_stream ? QString() : m_hashFiles.value(hash);
+    const QString& first = source.isEmpty() ? outputFiles.first() : source;
+    for (qsizetype i = 0; i < outputFiles.size(); ++i)
+        m_hashIndex.append({ outputFiles.at(i), hash, i == 0 ? source : first });
+    return source;
+}
+
+QImage::Format FrameEncoder::preferredImageFormat(const QString& outputFormat)
+{
+    if (FrameStream::isStreamFormat(outputFormat) || FrameArchive::isArchiveFormat(outputFormat))
+        return QImage::Format_RGBA8888_Premultiplied;
+    // Formats with alpha store it straight, the others drop it, which keeps premultiplied colour composited over black.
+    const QString format = outputFormat.toLower();
+    if (format == "qoi")
+        return QImage::Format_RGBA8888;
+    if (format == "png" || format == "tga" || format == "tif" || format == "tiff" || format == "webp")
+        return QImage::Format_ARGB32;
+    return QImage::Format_ARGB32_Premultiplied;
+}
+
+void FrameEncoder::enqueue(const QImage& image, const QString& outputFile)
+{
+    enqueue(image, QStringList { outputFile });
+}
+
+void FrameEncoder::enqueue(const QImage& image, const QStringList& outputFiles)
+{
+    if (outputFiles.isEmpty())
+        return;
+    submit([this, image, outputFiles]() { encode(image, outputFiles); });
+}
+
+void FrameEncoder::enqueue(const QImage& image, const QList<int>& frameNumbers)
+{
+    if (frameNumbers.isEmpty() || !m_archive)
+        return;
+    submit([this, image, frameNumbers]() { archive(image, frameNumbers); });
+}
+
+void FrameEncoder::submit(const std::function<void()>& task)
+{
+    // Backpressure: the render thread waits here while all slots are taken.
+    m_freeSlots.acquire();
+    m_queueDepth++;
+    if (m_metrics)
+        RenderMetrics::add(m_metrics->queuedFrames, 1);
+    QtConcurrent::run(&m_pool, [this, task]() {
+        task();
+        m_queueDepth--;
+        if (m_metrics)
+            RenderMetrics::add(m_metrics->queuedFrames, -1);
+        m_freeSlots.release();
+    });
+}
+
+void FrameEncoder::waitForFinished()
+{
+    m_pool.waitForDone();
+}
+
+void FrameEncoder::encode(const QImage& image, const QStringList& outputFiles)
+{
+    // The file that already holds these pixels, if any.
+    const quint64 hash = m_deduplicate ? FrameHash::hashImage(image) : 0;
+    const QString source = m_deduplicate ? registerFrame(hash, outputFiles) : QString();
+
+    if (m_stream) {
+        FrameProfileScope scope(m_profiler, FrameProfiler::Stage::Write);
+        const qint64 bytesWritten = m_stream->bytesWritten();
+        for (qsizetype i = 0; i < outputFiles.size(); ++i)
+            m_stream->writeFrame(image);
+        if (m_metrics)
+            RenderMetrics::add(m_metrics->bytesWritten, m_stream->bytesWritten() - bytesWritten);
+    } else {
+        const QString& first = source.isEmpty() ? outputFiles.first() : source;
+        if (!source.isEmpty()) {
+            m_duplicateFrames++;
+            linkFile(source, outputFiles.first());
+        } else if (!saveImage(image, first)) {
+            qWarning() << "Unable to save:" << first;
+        } else if (m_deduplicate) {
+            // Only offered for linking once written. Identical frames encoding
+            // concurrently are both written, which is still correct.
+            QMutexLocker lock(&m_hashMutex);
+            m_hashFiles.insert(hash, first);
+        }
+        for (qsizetype i = 1; i < outputFiles.size(); ++i)
+            linkFile(first, outputFiles.at(i));
+    }
+
+    if (m_metrics)
+        RenderMetrics::add(m_metrics->encodedFrames, outputFiles.size());
+    emit frameEncoded(m_encodedFrames += int(outputFiles.size()));
+}
+
+void FrameEncoder::archive(const QImage& image, const QList<int>& frameNumbers)
+{
+    // The index entries are keyed by frame number instead of file name.
+    QStringList frames;
+    for (const int frameNumber : frameNumbers)
+        frames.append(QString::number(frameNumber));
+    const quint64 hash = m_deduplicate ? FrameHash::hashImage(image) : 0;
+    const QString source = m_deduplicate ? registerFrame(hash, frames) : QString();
+
+    qint64 bytesWritten = 0;
+    {
+        FrameProfileScope scope(m_profiler, FrameProfiler::Stage::Write);
+        const int first = source.isEmpty() ? frameNumbers.first() : source.toInt();
+        if (!source.isEmpty()) {
+            m_duplicateFrames++;
+            m_archive->linkFrame(frameNumbers.first(), first);
+        } else if ((bytesWritten = m_archive->writeFrame(first, image)) < 0) {
+            qWarning() << "Unable to archive frame" << first;
+        } else if (m_deduplicate) {
+            QMutexLocker lock(&m_hashMutex);
+            m_hashFiles.insert(hash, frames.first());
+        }
+        for (qsizetype i = 1; i < frameNumbers.size(); ++i)
+            m_archive->linkFrame(frameNumbers.at(i), first);
+    }
+
+    if (m_metrics) {
+        RenderMetrics::add(m_metrics->bytesWritten, qMax<qint64>(0, bytesWritten));
+        RenderMetrics::add(m_metrics->encodedFrames, frameNumbers.size());
+    }
+    emit frameEncoded(m_encodedFrames += int(frameNumbers.size()));
+}
+
+// Same as QImage::save() with the job's image options, split into the encode and write stages.
+bool FrameEncoder::saveImage(const QImage& image, const QString& fileName)
+{
+    QBuffer buffer;
+    {
+        FrameProfileScope scope(m_profiler, FrameProfiler::Stage::Encode);
+        buffer.open(QIODevice::WriteOnly);
+        if (!ImageEncoder::write(image, &buffer, QFileInfo(fileName).suffix(), m_imageOptions))
+            return false;
+    }
+
+    FrameProfileScope scope(m_profiler, FrameProfiler::Stage::Write);
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(buffer.data()) != buffer.size())
+        return false;
+    if (m_metrics)
+        RenderMetrics::add(m_metrics->bytesWritten, buffer.size());
+    return true;
+}
+
+// Hard links repeated frames, falls back to a copy where the file system can't link.
+bool FrameEncoder::linkFile(const QString& source, const QString& target)
+{
+    QFile::remove(target);
+    std::error_code error;
+    std::filesystem::create_hard_link(QFileInfo(source).filesystemAbsoluteFilePath(), QFileInfo(target).filesystemAbsoluteFilePath(), error);
+    if (!error)
+        return true;
+    if (QFile::copy(source, target))
+        return true;
+    qWarning() << "Unable to save:" << target;
+    return false;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "FrameArchive.h"
+#include "FrameProfiler.h"
+#include "FrameStream.h"
+#include "ImageEncoder.h"
+#include "RenderMetrics.h"
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSemaphore>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <atomic>
+#include <functional>
+
+// Bounded producer/consumer stage between the render loop and the image
+// encoders. The render thread hands finished frames to enqueue(), which only
+// blocks once maxQueueDepth frames are already waiting or being encoded.
+class FrameEncoder : public QObject {
+    Q_OBJECT
+public:
+    explicit FrameEncoder(QObject* parent = nullptr);
+    ~FrameEncoder();
+
+    void setWorkerCount(int workerCount);
+    void setMaxQueueDepth(int maxQueueDepth);
+    int maxQueueDepth() const { return m_maxQueueDepth; }
+
+    // With a stream set, frames are written to it in enqueue order by a single worker.
+    void setStream(FrameStream* stream);
+    FrameStream* stream() const { return m_stream; }
+    // With an archive set, frames go into its slots by frame number, in
+    // parallel, see enqueue(const QImage&, const QList<int>&).
+    void setArchive(FrameArchive* archive);
+    FrameArchive* archive() const { return m_archive; }
+
+    // Records the encode and write stages.
+    void setProfiler(FrameProfiler* profiler) { m_profiler = profiler; }
+    // Adds queued and encoded frames and written bytes to metrics, may be null.
+    void setMetrics(RenderMetrics* metrics) { m_metrics = metrics; }
+
+    // Compression settings of the image files, set while idle.
+    void setImageOptions(const ImageEncoder::Options& options) { m_imageOptions = options; }
+
+    // Forgets the encoded frames and hashes of the previous job.
+    void reset();
+
+    // Hash every frame, frames with the same pixels as an earlier one are hard
+    // linked to its file instead of being encoded again.
+    void setDeduplicate(bool deduplicate);
+    bool deduplicate() const { return m_deduplicate; }
+    int duplicateFrames() const { return m_duplicateFrames; }
+    // Writes "<file> <xxh64> [<file it links to>]" per frame, in frame order. For
+    // streams the file column is the position in the stream.
+    bool writeHashIndex(const QString& fileName);
+
+    // The image format the writer for outputFormat consumes without another conversion.
+    static QImage::Format preferredImageFormat(const QString& outputFormat);
+
+    void enqueue(const QImage& image, const QString& outputFile = QString());
+    // Encodes the image once and hard links it to the other files, or writes it
+    // once per entry into the stream. Counts as outputFiles.size() frames.
+    void enqueue(const QImage& image, const QStringList& outputFiles);
+    // Archive output, writes the image into the slot of the first frame and
+    // links the other frames to it.
+    void enqueue(const QImage& image, const QList<int>& frameNumbers);
+    void waitForFinished();
+
+    int queueDepth() const { return m_queueDepth; }
+    int encodedFrames() const { return m_encodedFrames; }
+
+signals:
+    // Emitted from the encoder worker threads.
+    void frameEncoded(int encodedFrames);
+
+private:
+    // Takes a queue slot and runs task on the pool.
+    void submit(const std::function<void()>& task);
+    void encode(const QImage& image, const QStringList& outputFiles);
+    void archive(const QImage& image, const QList<int>& frameNumbers);
+    bool saveImage(const QImage& image, const QString& fileName);
+    static bool linkFile(const QString& source, const QString& target);
+    // Adds outputFiles to the hash index, returns the file already holding these pixels.
+    QString registerFrame(quint64 hash, const QStringList& outputFiles);
+
+private:
+    QThreadPool m_pool;
+    QSemaphore m_freeSlots;
+    FrameStream* m_stream = nullptr;
+    FrameArchive* m_archive = nullptr;
+    ImageEncoder::Options m_imageOptions;
+    FrameProfiler* m_profiler = nullptr;
+    RenderMetrics* m_metrics = nullptr;
+    int m_workerCount = 1;
+    int m_maxQueueDepth = 0;
+    std::atomic<int> m_queueDepth = 0;
+    std::atomic<int> m_encodedFrames = 0;
+
+    struct HashEntry {
+        QString file;
+        quint64 hash = 0;
+        QString source;
+    };
+    bool m_deduplicate = false;
+    std::atomic<int> m_duplicateFrames = 0;
+    QMutex m_hashMutex;
+    QHash<quint64, QString> m_hashFiles;
+    QList<HashEntry> m_hashIndex;
+};
@@ -0,0 +1,124 @@
+#include "FrameHash.h"
+
+#include <QString>
+#include <QtEndian>
+#include <cstring>
+
+namespace FrameHash {
+
+namespace {
+
+    constexpr quint64 prime1 = 0x9E3779B185EBCA87ULL;
+    constexpr quint64 prime2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr quint64 prime3 = 0x165667B19E3779F9ULL;
+    constexpr quint64 prime4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr quint64 prime5 = 0x27D4EB2F165667C5ULL;
+
+    inline quint64 rotl(quint64 value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline quint64 read64(const uchar* data)
+    {
+        quint64 value;
+        std::memcpy(&value, data, sizeof(value));
+        return qFromLittleEndian(value);
+    }
+
+    inline quint32 read32(const uchar* data)
+    {
+        quint32 value;
+        std::memcpy(&value, data, sizeof(value));
+        return qFromLittleEndian(value);
+    }
+
+    inline quint64 round(quint64 accumulator, quint64 input)
+    {
+        accumulator += input * prime2;
+        accumulator = rotl(accumulator, 31);
+        return accumulator * prime1;
+    }
+
+    inline quint64 mergeRound(quint64 accumulator, quint64 value)
+    {
+        accumulator ^= round(0, value);
+        return accumulator * prime1 + prime4;
+    }
+
+}
+
+quint64 hash(const void* data, qsizetype size, quint64 seed)
+{
+    const uchar* p = static_cast<const uchar*>(data);
+    const uchar* const end = p + size;
+    quint64 h;
+
+    if (size >= 32) {
+        // Four independent lanes, which keeps the multipliers busy.
+        quint64 v1 = seed + prime1 + prime2;
+        quint64 v2 = seed + prime2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - prime1;
+        const uchar* const limit = end - 32;
+        do {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + prime5;
+    }
+
+    h += quint64(size);
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+    if (p + 4 <= end) {
+        h ^= quint64(read32(p)) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+quint64 hashImage(const QImage& image)
+{
+    const quint64 seed = (quint64(image.width()) << 40) ^ (quint64(image.height()) << 16) ^ quint64(image.format());
+    const qsizetype rowSize = (qsizetype(image.width()) * image.depth() + 7) / 8;
+    if (image.bytesPerLine() == rowSize)
+        return hash(image.constBits(), image.sizeInBytes(), seed);
+
+    // Padded scan lines, chain the rows instead.
+    quint64 h = seed;
+    for (int y = 0; y < image.height(); ++y)
+        h = hash(image.constScanLine(y), rowSize, h);
+    return h;
+}
+
+QString toString(quint64 hash)
+{
+    return QString("%1").arg(hash, 16, 16, QChar('0'));
+}
+
+}
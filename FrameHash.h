@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QImage>
+#include <QtGlobal>
+
+// XXH64 (https://github.com/Cyan4973/xxHash), fast enough to hash every read
+// back frame on the encoder workers. Used to find frames with identical pixels
+// and as a fingerprint of a render.
+namespace FrameHash {
+
+quint64 hash(const void* data, qsizetype size, quint64 seed = 0);
+
+// Hashes the pixels of image, ignoring scan line padding. Size and format are
+// part of the hash.
+quint64 hashImage(const QImage& image);
+
+QString toString(quint64 hash);
+
+}
@@ -0,0 +1,224 @@
+#include "FrameProfiler.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+
+std::atomic<bool> FrameProfiler::s_enabled = false;
+
+namespace {
+
+std::atomic<quint64> nextProfilerId = 1;
+
+// Last buffer used by this thread, saves the lookup for every event.
+struct CachedBuffer {
+    quint64 profilerId = 0;
+    void* buffer = nullptr;
+};
+thread_local CachedBuffer cachedBuffer;
+
+}
+
+FrameProfiler::FrameProfiler()
+    : m_id(nextProfilerId++)
+{
+}
+
+const char* FrameProfiler::stageName(Stage stage)
+{
+    switch (stage) {
+    case Stage::Polish:
+        return "polish";
+    case Stage::BeginFrame:
+        return "beginFrame";
+    case Stage::Sync:
+        return "sync";
+    case Stage::Render:
+        return "render";
+    case Stage::EndFrame:
+        return "endFrame";
+    case Stage::Downsample:
+        return "downsample";
+    case Stage::Accumulate:
+        return "accumulate";
+    case Stage::YuvConversion:
+        return "yuvConversion";
+    case Stage::Readback:
+        return "readback";
+    case Stage::Conversion:
+        return "conversion";
+    case Stage::Encode:
+        return "encode";
+    case Stage::Write:
+        return "write";
+    case Stage::Count:
+        break;
+    }
+    return "unknown";
+}
+
+qint64 FrameProfiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameProfiler::record(Stage stage, qint64 start, qint64 end, int frame)
+{
+    threadBuffer()->events.append({ start, end - start, frame, stage });
+}
+
+FrameProfiler::ThreadBuffer* FrameProfiler::threadBuffer()
+{
+    const quint64 id = m_id.load(std::memory_order_relaxed);
+    if (cachedBuffer.profilerId == id)
+        return static_cast<ThreadBuffer*>(cachedBuffer.buffer);
+
+    QMutexLocker lock(&m_mutex);
+    const Qt::HANDLE thread = QThread::currentThreadId();
+    ThreadBuffer* buffer = nullptr;
+    for (const auto& [handle, threadBuffer] : m_threads) {
+        if (handle == thread)
+            buffer = threadBuffer;
+    }
+    if (!buffer) {
+        m_buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = m_buffers.back().get();
+        buffer->threadIndex = int(m_buffers.size());
+        buffer->threadName = QThread::currentThread()->objectName();
+        if (buffer->threadName.isEmpty())
+            buffer->threadName = QString("thread %1").arg(buffer->threadIndex);
+        buffer->events.reserve(1024);
+        m_threads.emplace_back(thread, buffer);
+    }
+    cachedBuffer = { id, buffer };
+    return buffer;
+}
+
+void FrameProfiler::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_buffers.clear();
+    m_threads.clear();
+    m_id = nextProfilerId++;
+}
+
+bool FrameProfiler::isEmpty() const
+{
+    QMutexLocker lock(&m_mutex);
+    return std::all_of(m_buffers.begin(), m_buffers.end(), [](const auto& buffer) { return buffer->events.isEmpty(); });
+}
+
+bool FrameProfiler::writeChromeTrace(const QString& fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Unable to save:" << fileName << file.errorString();
+        return false;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    qint64 origin = std::numeric_limits<qint64>::max();
+    for (const auto& buffer : m_buffers) {
+        if (!buffer->events.isEmpty())
+            origin = qMin(origin, buffer->events.constFirst().start);
+    }
+
+    // Complete ("X") events in µs, one track per thread.
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& buffer : m_buffers) {
+        // Thread names are arbitrary strings, QJsonDocument escapes them.
+        const QJsonObject threadName {
+            { "ph", "M" },
+            { "name", "thread_name" },
+            { "pid", 1 },
+            { "tid", buffer->threadIndex },
+            { "args", QJsonObject { { "name", buffer->threadName } } },
+        };
+        if (!first)
+            json += ",\n";
+        json += QJsonDocument(threadName).toJson(QJsonDocument::Compact);
+        first = false;
+        for (const Event& event : buffer->events) {
+            json += QString(",\n{\"ph\":\"X\",\"name\":\"%1\",\"pid\":1,\"tid\":%2,\"ts\":%3,\"dur\":%4")
+                        .arg(stageName(event.stage))
+                        .arg(buffer->threadIndex)
+                        .arg((event.start - origin) / 1000.0, 0, 'f', 3)
+                        .arg(event.duration / 1000.0, 0, 'f', 3)
+                        .toUtf8();
+            json += event.frame >= 0 ? QString(",\"args\":{\"frame\":%1}}").arg(event.frame).toUtf8() : QByteArray("}");
+        }
+    }
+    json += "\n]}\n";
+    return file.write(json) == json.size();
+}
+
+QList<FrameProfiler::StageStatistics> FrameProfiler::statistics() const
+{
+    std::array<QList<qint64>, size_t(Stage::Count)> durations;
+    {
+        QMutexLocker lock(&m_mutex);
+        for (const auto& buffer : m_buffers) {
+            for (const Event& event : buffer->events)
+                durations[size_t(event.stage)].append(event.duration);
+        }
+    }
+
+    QList<StageStatistics> statistics;
+    for (size_t stage = 0; stage < durations.size(); ++stage) {
+        QList<qint64>& values = durations[stage];
+        if (values.isEmpty())
+            continue;
+        std::sort(values.begin(), values.end());
+        // Nearest rank
+        auto percentile = [&values](int p) {
+            return values.at(qBound<qsizetype>(0, (values.size() * p + 99) / 100 - 1, values.size() - 1)) / 1e6;
+        };
+        qint64 total = 0;
+        for (const qint64 value : std::as_const(values))
+            total += value;
+        statistics.append({ Stage(stage), int(values.size()), total / 1e6 / values.size(),
+            percentile(50), percentile(95), percentile(99), values.constLast() / 1e6 });
+    }
+    return statistics;
+}
+
+QString FrameProfiler::summary() const
+{
+    QString summary = QString("%1 %2 %3 %4 %5 %6 %7\n")
+                          .arg("stage", -14)
+                          .arg("count", 7)
+                          .arg("mean", 9)
+                          .arg("p50", 9)
+                          .arg("p95", 9)
+                          .arg("p99", 9)
+                          .arg("max", 9);
+    for (const StageStatistics& stage : statistics()) {
+        summary += QString("%1 %2 %3 %4 %5 %6 %7\n")
+                       .arg(stageName(stage.stage), -14)
+                       .arg(stage.count, 7)
+                       .arg(stage.mean, 9, 'f', 3)
+                       .arg(stage.p50, 9, 'f', 3)
+                       .arg(stage.p95, 9, 'f', 3)
+                       .arg(stage.p99, 9, 'f', 3)
+                       .arg(stage.max, 9, 'f', 3);
+    }
+    return summary;
+}
+
+QJsonObject FrameProfiler::toJson() const
+{
+    QJsonObject stages;
+    for (const StageStatistics& stage : statistics()) {
+        stages.insert(stageName(stage.stage),
+            QJsonObject { { "count", stage.count }, { "mean", stage.mean }, { "p50", stage.p50 },
+                { "p95", stage.p95 }, { "p99", stage.p99 }, { "max", stage.max } });
+    }
+    return stages;
+}
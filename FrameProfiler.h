@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Per stage timings of one render job. Every thread appends to its own buffer
+// without locking, the results are read once the job is done: as a Chrome /
+// Perfetto trace (chrome://tracing, ui.perfetto.dev) and as percentiles per
+// stage. Switched on and off process wide at runtime, a disabled profiler
+// costs one relaxed atomic load per stage.
+class FrameProfiler {
+public:
+    enum class Stage {
+        Polish,
+        BeginFrame,
+        Sync,
+        Render,
+        EndFrame, // endFrame() and glFlush()
+        Downsample, // GpuDownsampler blits of supersampled frames
+        Accumulate, // GpuFrameAccumulator passes of motion blur sub-frames
+        YuvConversion, // GpuYuvConverter pass
+        Readback, // glReadPixels, fence wait and map
+        Conversion, // PixelConversion into the encoder's format
+        Encode,
+        Write,
+        Count,
+    };
+
+    FrameProfiler();
+
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static const char* stageName(Stage stage);
+    // Steady clock in ns
+    static qint64 now();
+
+    void record(Stage stage, qint64 start, qint64 end, int frame = -1);
+    // Must not be called while other threads record.
+    void clear();
+    bool isEmpty() const;
+
+    bool writeChromeTrace(const QString& fileName) const;
+    struct StageStatistics {
+        Stage stage = Stage::Polish;
+        int count = 0;
+        // ms
+        double mean = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+    // Recorded stages only, in Stage order.
+    QList<StageStatistics> statistics() const;
+    // One line per stage: count, mean, p50, p95, p99 and max in ms.
+    QString summary() const;
+    // {"<stage>": {"count", "mean", "p50", "p95", "p99", "max"}}, times in ms
+    QJsonObject toJson() const;
+
+private:
+    struct Event {
+        qint64 start = 0;
+        qint64 duration = 0;
+        int frame = -1;
+        Stage stage = Stage::Polish;
+    };
+    struct ThreadBuffer {
+        int threadIndex = 0;
+        QString threadName;
+        QList<Event> events;
+    };
+
+    ThreadBuffer* threadBuffer();
+
+private:
+    static std::atomic<bool> s_enabled;
+    // Identifies this profiler in the per-thread buffer cache, changes with clear().
+    std::atomic<quint64> m_id;
+    mutable QMutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    std::vector<std::pair<Qt::HANDLE, ThreadBuffer*>> m_threads;
+};
+
+// Records the lifetime of the scope as one stage, when profiling is enabled.
+class FrameProfileScope {
+public:
+    FrameProfileScope(FrameProfiler* profiler, FrameProfiler::Stage stage, int frame = -1)
+        : m_profiler(profiler && FrameProfiler::isEnabled() ? profiler : nullptr)
+        , m_stage(stage)
+        , m_frame(frame)
+        , m_start(m_profiler ? FrameProfiler::now() : 0)
+    {
+    }
+    ~FrameProfileScope()
+    {
+        if (m_profiler)
+            m_profiler->record(m_stage, m_start, FrameProfiler::now(), m_frame);
+    }
+    FrameProfileScope(const FrameProfileScope&) = delete;
+    FrameProfileScope& operator=(const FrameProfileScope&) = delete;
+
+private:
+    FrameProfiler* m_profiler;
+    FrameProfiler::Stage m_stage;
+    int m_frame;
+    qint64 m_start;
+};
@@ -0,0 +1,132 @@
+#include "FrameReadback.h"
+#include "PixelConversion.h"
+
+#include <QOpenGLContext>
+#include <cstring>
+
+FrameReadback::FrameReadback(int bufferCount)
+{
+    for (int i = 0; i < qMax(1, bufferCount); ++i)
+        m_slots.append(new Slot);
+}
+
+FrameReadback::~FrameReadback()
+{
+    destroy();
+    qDeleteAll(m_slots);
+}
+
+bool FrameReadback::create(const QSize& size, QImage::Format format)
+{
+    QOpenGLContext* ctx = QOpenGLContext::currentContext();
+    if (!ctx) {
+        qWarning("FrameReadback: No context");
+        return false;
+    }
+    m_functions = ctx->extraFunctions();
+    m_size = size;
+    m_format = format;
+    // Rows are padded to GL_PACK_ALIGNMENT, 4 by default, like QImage scanlines.
+    m_stride = ((size.width() * (format == QImage::Format_Grayscale8 ? 1 : 4)) + 3) & ~3;
+
+    const qsizetype byteCount = m_stride * size.height();
+    for (Slot* slot : m_slots) {
+        if (!slot->buffer.create()) {
+            qWarning("FrameReadback: Unable to create pixel buffer object");
+            return false;
+        }
+        slot->buffer.setUsagePattern(QOpenGLBuffer::StreamRead);
+        slot->buffer.bind();
+        slot->buffer.allocate(byteCount);
+        slot->buffer.release();
+    }
+    return true;
+}
+
+void FrameReadback::destroy()
+{
+    for (Slot* slot : m_slots) {
+        if (slot->fence)
+            m_functions->glDeleteSync(slot->fence);
+        slot->fence = nullptr;
+        slot->frameNumber = -1;
+        slot->buffer.destroy();
+    }
+    m_next = 0;
+    m_pending = 0;
+}
+
+void FrameReadback::read(QOpenGLFramebufferObject* fbo, int frameNumber)
+{
+    Q_ASSERT(!isFull());
+
+    Slot* slot = m_slots[m_next];
+    m_next = (m_next + 1) % m_slots.size();
+    m_pending++;
+
+    fbo->bind();
+    slot->buffer.bind();
+    // With a pixel pack buffer bound the last argument is an offset,
+    // glReadPixels returns as soon as the copy is queued.
+    const GLenum glFormat = m_format == QImage::Format_Grayscale8 ? GL_RED : GL_RGBA;
+    m_functions->glReadPixels(0, 0, m_size.width(), m_size.height(), glFormat, GL_UNSIGNED_BYTE, nullptr);
+    slot->buffer.release();
+    QOpenGLFramebufferObject::bindDefault();
+
+    slot->fence = m_functions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->frameNumber = frameNumber;
+    m_functions->glFlush();
+}
+
+FrameReadback::Frame FrameReadback::takeOldest()
+{
+    Frame frame;
+    if (!hasPending())
+        return frame;
+
+    const int index = (m_next - m_pending + m_slots.size()) % m_slots.size();
+    Slot* slot = m_slots[index];
+    m_pending--;
+
+    const bool profile = m_profiler && FrameProfiler::isEnabled();
+    const qint64 waitStart = profile ? FrameProfiler::now() : 0;
+    while (m_functions->glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) { }
+    m_functions->glDeleteSync(slot->fence);
+    slot->fence = nullptr;
+
+    frame.frameNumber = slot->frameNumber;
+
+    slot->buffer.bind();
+    const auto* pixels = static_cast<const uchar*>(slot->buffer.mapRange(0, slot->buffer.size(), QOpenGLBuffer::RangeRead));
+    if (profile)
+        m_profiler->record(FrameProfiler::Stage::Readback, waitStart, FrameProfiler::now(), frame.frameNumber);
+    FrameProfileScope conversionScope(m_profiler, FrameProfiler::Stage::Conversion, frame.frameNumber);
+    if (!pixels) {
+        qWarning("FrameReadback: Unable to map pixel buffer object");
+    } else if (m_format == QImage::Format_Grayscale8) {
+        frame.image = QImage(m_size, m_format);
+        for (int y = 0; y < m_size.height(); ++y)
+            std::memcpy(frame.image.scanLine(y), pixels + y * m_stride, m_stride);
+    } else {
+        // GL rows are bottom-up, flip and convert while copying out of the mapped buffer.
+        frame.image = PixelConversion::convertImage(pixels, m_stride, m_size, m_outputFormat, true);
+    }
+    if (pixels)
+        slot->buffer.unmap();
+    slot->buffer.release();
+
+    return frame;
+}
+
+QImage FrameReadback::readImage(QOpenGLFramebufferObject* fbo, QImage::Format outputFormat)
+{
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+    const QSize size = fbo->size();
+    QByteArray pixels(qsizetype(size.width()) * size.height() * 4, Qt::Uninitialized);
+
+    fbo->bind();
+    f->glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    QOpenGLFramebufferObject::bindDefault();
+
+    return PixelConversion::convertImage(reinterpret_cast<const uchar*>(pixels.constData()), size.width() * 4, size, outputFormat, true);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "FrameProfiler.h"
+#include <QImage>
+#include <QOpenGLBuffer>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QSize>
+#include <QVector>
+
+// Asynchronous readback through a ring of pixel buffer objects.
+// read() only queues a glReadPixels into the next PBO and drops a fence, the
+// pixels are mapped by takeOldest() once the ring is full, typically while
+// the GPU is already busy with a later frame.
+// Must be created, used and destroyed with the same context current.
+// Rgba frames are flipped to top-down order and converted to outputFormat
+// in the same pass, Format_Grayscale8 (planar yuv from GpuYuvConverter) is
+// already top-down.
+class FrameReadback {
+public:
+    struct Frame {
+        int frameNumber = -1;
+        QImage image;
+    };
+
+    explicit FrameReadback(int bufferCount = 2);
+    ~FrameReadback();
+
+    bool create(const QSize& size, QImage::Format format = QImage::Format_RGBA8888_Premultiplied);
+    void destroy();
+
+    // Format the rgba frames are handed out in, see PixelConversion.
+    void setOutputFormat(QImage::Format outputFormat) { m_outputFormat = outputFormat; }
+    void setProfiler(FrameProfiler* profiler) { m_profiler = profiler; }
+
+    // Synchronous replacement for QOpenGLFramebufferObject::toImage() using the same conversion.
+    static QImage readImage(QOpenGLFramebufferObject* fbo, QImage::Format outputFormat);
+
+    void read(QOpenGLFramebufferObject* fbo, int frameNumber);
+    Frame takeOldest();
+
+    bool isFull() const { return m_pending == m_slots.size(); }
+    bool hasPending() const { return m_pending > 0; }
+
+private:
+    struct Slot {
+        QOpenGLBuffer buffer { QOpenGLBuffer::PixelPackBuffer };
+        GLsync fence = nullptr;
+        int frameNumber = -1;
+    };
+
+    QOpenGLExtraFunctions* m_functions = nullptr;
+    FrameProfiler* m_profiler = nullptr;
+    QVector<Slot*> m_slots;
+    QSize m_size;
+    QImage::Format m_format = QImage::Format_RGBA8888_Premultiplied;
+    QImage::Format m_outputFormat = QImage::Format_RGBA8888_Premultiplied;
+    qsizetype m_stride = 0;
+    int m_next = 0;
+    int m_pending = 0;
+};
@@ -0,0 +1,78 @@
+#include "FrameScheduler.h"
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+
+FrameScheduler::FrameScheduler(QObject* parent)
+    : QObject(parent)
+{
+}
+
+void FrameScheduler::start(Step step)
+{
+    m_step = std::move(step);
+    m_cancelled = false;
+    m_running = true;
+    scheduleSlice();
+}
+
+void FrameScheduler::setPaused(bool paused)
+{
+    m_paused = paused;
+    if (!paused)
+        scheduleSlice();
+}
+
+void FrameScheduler::cancel()
+{
+    m_cancelled = true;
+    // Also wakes a paused scheduler so it can finish.
+    scheduleSlice();
+}
+
+void FrameScheduler::waitForFinished()
+{
+    if (!m_running)
+        return;
+    QEventLoop loop;
+    QObject::connect(this, &FrameScheduler::finished, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+void FrameScheduler::scheduleSlice()
+{
+    // At most one slice is queued, however often pause and resume toggle.
+    if (!m_slicePending.exchange(true))
+        QMetaObject::invokeMethod(this, &FrameScheduler::runSlice, Qt::QueuedConnection);
+}
+
+void FrameScheduler::runSlice()
+{
+    m_slicePending = false;
+    if (!m_running)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        if (m_cancelled) {
+            finish();
+            return;
+        }
+        // setPaused(false) queues the next slice.
+        if (m_paused)
+            return;
+        if (!m_step()) {
+            finish();
+            return;
+        }
+    } while (timer.elapsed() < m_sliceDuration);
+    scheduleSlice();
+}
+
+void FrameScheduler::finish()
+{
+    m_running = false;
+    m_step = nullptr;
+    emit finished(m_cancelled);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QObject>
+#include <atomic>
+#include <functional>
+
+// Drives a job's frames as a flat loop on the thread the scheduler lives in.
+// Frames are rendered back to back for one slice, then the event loop runs,
+// so the job can be paused or cancelled and jobs on the same thread take turns.
+class FrameScheduler : public QObject {
+    Q_OBJECT
+public:
+    // Renders one frame, returns false after the last one.
+    using Step = std::function<bool()>;
+
+    explicit FrameScheduler(QObject* parent = nullptr);
+
+    void start(Step step);
+    // Thread safe, start() keeps the paused state. Cancelling stops before
+    // the next frame, finished() is still emitted.
+    void setPaused(bool paused);
+    void cancel();
+    bool isPaused() const { return m_paused; }
+    bool isCancelled() const { return m_cancelled; }
+    bool isRunning() const { return m_running; }
+
+    // Time spent rendering before the event loop runs, 0 yields after every frame.
+    void setSliceDuration(int sliceDurationMs) { m_sliceDuration = sliceDurationMs; }
+    int sliceDuration() const { return m_sliceDuration; }
+
+    // Runs an event loop on the scheduler's thread until finished(), for synchronous callers.
+    void waitForFinished();
+
+signals:
+    void finished(bool cancelled);
+
+private:
+    void scheduleSlice();
+    void runSlice();
+    void finish();
+
+private:
+    Step m_step;
+    std::atomic<bool> m_running = false;
+    std::atomic<bool> m_paused = false;
+    std::atomic<bool> m_cancelled = false;
+    std::atomic<bool> m_slicePending = false;
+    int m_sliceDuration = 50;
+};
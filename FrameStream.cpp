@@ -0,0 +1,172 @@
+#include "FrameStream.h"
+
+#include <QDebug>
+
+FrameStream::~FrameStream()
+{
+    close();
+}
+
+bool FrameStream::isStreamFormat(const QString& outputFormat)
+{
+    return outputFormat == "y4m" || outputFormat == "rgba" || outputFormat == "pipe";
+}
+
+bool FrameStream::open(const QString& outputFormat, const QString& fileName, const QString& command,
+    const QSize& size, const FrameRate& frameRate)
+{
+    m_format = outputFormat == "rgba" ? Format::Rgba : Format::Y4m;
+    m_size = size;
+    m_bytesWritten = 0;
+
+    if (outputFormat == "pipe") {
+        if (command.isEmpty()) {
+            qWarning("FrameStream: No command to pipe into");
+            return false;
+        }
+#ifdef Q_OS_WIN
+        m_pipe = _popen(command.toLocal8Bit().constData(), "wb");
+#else
+        m_pipe = popen(command.toLocal8Bit().constData(), "w");
+#endif
+        if (!m_pipe || !m_file.open(m_pipe, QIODevice::WriteOnly)) {
+            qWarning() << "FrameStream: Unable to start:" << command;
+            close();
+            return false;
+        }
+    } else {
+        m_file.setFileName(fileName);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning() << "FrameStream: Unable to open:" << fileName << m_file.errorString();
+            return false;
+        }
+    }
+
+    if (m_format == Format::Y4m) {
+        const QByteArray header = y4mHeader(size, frameRate, m_fullRange);
+        return write(header.constData(), header.size());
+    }
+    return true;
+}
+
+QByteArray FrameStream::y4mHeader(const QSize& size, const FrameRate& frameRate, bool fullRange)
+{
+    return QString("YUV4MPEG2 W%1 H%2 F%3:%4 Ip A1:1 C420jpeg XCOLORRANGE=%5\n")
+        .arg(size.width())
+        .arg(size.height())
+        .arg(frameRate.numerator)
+        .arg(frameRate.denominator)
+        .arg(fullRange ? "FULL" : "LIMITED")
+        .toLatin1();
+}
+
+void FrameStream::close()
+{
+    m_file.close();
+    if (m_pipe) {
+#ifdef Q_OS_WIN
+        _pclose(m_pipe);
+#else
+        pclose(m_pipe);
+#endif
+        m_pipe = nullptr;
+    }
+}
+
+bool FrameStream::writeFrame(const QImage& image)
+{
+    if (!isOpen())
+        return false;
+
+    if (m_format == Format::Y4m && image.format() == QImage::Format_Grayscale8)
+        return writePlanes(image);
+
+    QImage frame = image;
+    if (frame.size() != m_size) {
+        qWarning() << "FrameStream: Frame size" << frame.size() << "does not match" << m_size;
+        return false;
+    }
+    if (frame.format() != QImage::Format_RGBA8888_Premultiplied)
+        frame.convertTo(QImage::Format_RGBA8888_Premultiplied);
+
+    if (m_format == Format::Rgba) {
+        const qsizetype stride = m_size.width() * 4;
+        for (int y = 0; y < m_size.height(); ++y) {
+            if (!write(reinterpret_cast<const char*>(frame.constScanLine(y)), stride))
+                return false;
+        }
+        return true;
+    }
+
+    const qsizetype lumaSize = qsizetype(m_size.width()) * m_size.height();
+    const qsizetype chromaSize = qsizetype((m_size.width() + 1) / 2) * ((m_size.height() + 1) / 2);
+    m_buffer.resize(6 + lumaSize + 2 * chromaSize);
+    uchar* data = reinterpret_cast<uchar*>(m_buffer.data());
+    memcpy(data, "FRAME\n", 6);
+    convertToYuv420(frame, data + 6, data + 6 + lumaSize, data + 6 + lumaSize + chromaSize, m_fullRange);
+    return write(m_buffer.constData(), m_buffer.size());
+}
+
+bool FrameStream::writePlanes(const QImage& planes)
+{
+    if (planes.width() != m_size.width() || planes.height() != m_size.height() * 3 / 2) {
+        qWarning() << "FrameStream: Plane size" << planes.size() << "does not match" << m_size;
+        return false;
+    }
+    if (!write("FRAME\n", 6))
+        return false;
+    for (int y = 0; y < planes.height(); ++y) {
+        if (!write(reinterpret_cast<const char*>(planes.constScanLine(y)), planes.width()))
+            return false;
+    }
+    return true;
+}
+
+// BT.709, 8 bit fixed point. Premultiplied colour is used as is, which is the
+// frame composited over black.
+void FrameStream::convertToYuv420(const QImage& image, uchar* y, uchar* u, uchar* v, bool fullRange)
+{
+    // Limited range scales luma to 16..235 and chroma to 16..240
+    const int yr = fullRange ? 54 : 47, yg = fullRange ? 183 : 157, yb = fullRange ? 19 : 16;
+    const int yOffset = fullRange ? 0 : 16;
+    const int ur = fullRange ? -29 : -26, ug = fullRange ? -99 : -86, ub = fullRange ? 128 : 112;
+    const int vr = fullRange ? 128 : 112, vg = fullRange ? -116 : -102, vb = fullRange ? -12 : -10;
+
+    const int width = image.width();
+    const int height = image.height();
+    const int chromaWidth = (width + 1) / 2;
+
+    for (int row = 0; row < height; ++row) {
+        const uchar* pixel = image.constScanLine(row);
+        uchar* luma = y + qsizetype(row) * width;
+        for (int x = 0; x < width; ++x, pixel += 4)
+            luma[x] = uchar(((yr * pixel[0] + yg * pixel[1] + yb * pixel[2] + 128) >> 8) + yOffset);
+    }
+
+    for (int row = 0; row < height; row += 2) {
+        const uchar* top = image.constScanLine(row);
+        const uchar* bottom = image.constScanLine(qMin(row + 1, height - 1));
+        uchar* cb = u + qsizetype(row / 2) * chromaWidth;
+        uchar* cr = v + qsizetype(row / 2) * chromaWidth;
+        for (int x = 0; x < width; x += 2) {
+            const int right = qMin(x + 1, width - 1) * 4;
+            const int left = x * 4;
+            const int r = (top[left] + top[right] + bottom[left] + bottom[right] + 2) >> 2;
+            const int g = (top[left + 1] + top[right + 1] + bottom[left + 1] + bottom[right + 1] + 2) >> 2;
+            const int b = (top[left + 2] + top[right + 2] + bottom[left + 2] + bottom[right + 2] + 2) >> 2;
+            cb[x / 2] = uchar(qBound(0, ((ur * r + ug * g + ub * b + 128) >> 8) + 128, 255));
+            cr[x / 2] = uchar(qBound(0, ((vr * r + vg * g + vb * b + 128) >> 8) + 128, 255));
+        }
+    }
+}
+
+bool FrameStream::write(const char* data, qint64 size)
+{
+    const qint64 written = m_file.write(data, size);
+    if (written != size) {
+        qWarning() << "FrameStream: Write failed:" << m_file.errorString();
+        return false;
+    }
+    m_bytesWritten += written;
+    return true;
+}
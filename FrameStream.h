@@ -0,0 +1,55 @@
+#pragma once
+
+#include "animationdriver.h"
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <cstdio>
+
+// Writes all frames of a job sequentially into one stream instead of one
+// image file per frame: a Y4M or raw RGBA file, or the stdin of an encoder
+// process. Frames must be written in order, from one thread at a time.
+class FrameStream {
+public:
+    enum class Format {
+        Y4m, // yuv420p, BT.709
+        Rgba, // premultiplied rgba, no header
+    };
+
+    FrameStream() = default;
+    ~FrameStream();
+
+    // "y4m" and "rgba" are streamed to <name>.<format>, "pipe" streams y4m to a command.
+    static bool isStreamFormat(const QString& outputFormat);
+
+    // Y4m only, must be set before open().
+    void setFullRange(bool fullRange) { m_fullRange = fullRange; }
+
+    bool open(const QString& outputFormat, const QString& fileName, const QString& command,
+        const QSize& size, const FrameRate& frameRate);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    // Takes rgba frames, or Format_Grayscale8 frames that already hold the
+    // I420 planes (see GpuYuvConverter) for y4m.
+    bool writeFrame(const QImage& image);
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+    static QByteArray y4mHeader(const QSize& size, const FrameRate& frameRate, bool fullRange);
+    static void convertToYuv420(const QImage& image, uchar* y, uchar* u, uchar* v, bool fullRange = false);
+
+private:
+    bool write(const char* data, qint64 size);
+    bool writePlanes(const QImage& planes);
+
+private:
+    QFile m_file;
+    FILE* m_pipe = nullptr;
+    Format m_format = Format::Y4m;
+    bool m_fullRange = false;
+    QSize m_size;
+    QByteArray m_buffer;
+    qint64 m_bytesWritten = 0;
+};
@@ -0,0 +1,53 @@
+#include "GpuDownsampler.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+GpuDownsampler::~GpuDownsampler()
+{
+    destroy();
+}
+
+bool GpuDownsampler::create(const QSize& sourceSize, const QSize& targetSize)
+{
+    destroy();
+    if (targetSize.isEmpty() || targetSize.width() > sourceSize.width() || targetSize.height() > sourceSize.height()) {
+        qWarning() << "GpuDownsampler: Unable to downsample" << sourceSize << "to" << targetSize;
+        return false;
+    }
+
+    QSize size = sourceSize;
+    while (size != targetSize) {
+        size = QSize(qMax(targetSize.width(), (size.width() + 1) / 2), qMax(targetSize.height(), (size.height() + 1) / 2));
+        auto target = std::make_unique<QOpenGLFramebufferObject>(size, QOpenGLFramebufferObject::NoAttachment);
+        if (!target->isValid()) {
+            qWarning() << "GpuDownsampler: Invalid target fbo" << size;
+            destroy();
+            return false;
+        }
+        m_targets.push_back(std::move(target));
+    }
+    return !m_targets.empty();
+}
+
+void GpuDownsampler::destroy()
+{
+    m_targets.clear();
+}
+
+QOpenGLFramebufferObject* GpuDownsampler::downsample(QOpenGLFramebufferObject* source)
+{
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+    // The scene graph may leave scissoring on, which also clips blits.
+    f->glDisable(GL_SCISSOR_TEST);
+
+    QOpenGLFramebufferObject* from = source;
+    for (const std::unique_ptr<QOpenGLFramebufferObject>& target : m_targets) {
+        f->glBindFramebuffer(GL_READ_FRAMEBUFFER, from->handle());
+        f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->handle());
+        f->glBlitFramebuffer(0, 0, from->width(), from->height(), 0, 0, target->width(), target->height(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        from = target.get();
+    }
+    QOpenGLFramebufferObject::bindDefault();
+    return from;
+}
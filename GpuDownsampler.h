@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QOpenGLFramebufferObject>
+#include <QSize>
+#include <memory>
+#include <vector>
+
+// Reduces a rendered frame to a smaller size on the GPU with a chain of
+// linear blits. Each step at most halves the size, so an exact 2:1 step
+// averages 2x2 pixels and power of two supersampling resolves to a box filter.
+// Readback then only moves the smaller frame.
+// Must be created, used and destroyed with the same context current.
+class GpuDownsampler {
+public:
+    GpuDownsampler() = default;
+    ~GpuDownsampler();
+
+    bool create(const QSize& sourceSize, const QSize& targetSize);
+    void destroy();
+
+    // Returns the fbo holding the downsampled source, bottom-up like the source.
+    QOpenGLFramebufferObject* downsample(QOpenGLFramebufferObject* source);
+
+    QSize outputSize() const { return m_targets.empty() ? QSize() : m_targets.back()->size(); }
+
+private:
+    std::vector<std::unique_ptr<QOpenGLFramebufferObject>> m_targets;
+};
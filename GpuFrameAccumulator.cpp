@@ -0,0 +1,123 @@
+#include "GpuFrameAccumulator.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+#ifndef GL_RGBA16F
+#define GL_RGBA16F 0x881A
+#endif
+
+// Fullscreen triangle, no vertex buffer needed.
+static const char* vertexShader = R"(#version 150
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+static const char* fragmentShader = R"(#version 150
+uniform sampler2D source;
+uniform float weight;
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = texelFetch(source, ivec2(gl_FragCoord.xy), 0) * weight;
+}
+)";
+
+GpuFrameAccumulator::~GpuFrameAccumulator()
+{
+    destroy();
+}
+
+bool GpuFrameAccumulator::create(const QSize& size)
+{
+    m_size = size;
+
+    m_program = std::make_unique<QOpenGLShaderProgram>();
+    if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader)
+        || !m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader)
+        || !m_program->link()) {
+        qWarning() << "GpuFrameAccumulator: Unable to build shader" << m_program->log();
+        destroy();
+        return false;
+    }
+    m_program->bind();
+    m_program->setUniformValue("source", 0);
+    m_program->release();
+
+    m_vao = std::make_unique<QOpenGLVertexArrayObject>();
+    m_vao->create();
+
+    m_sum = std::make_unique<QOpenGLFramebufferObject>(
+        size, QOpenGLFramebufferObject::NoAttachment, GL_TEXTURE_2D, GL_RGBA16F);
+    m_output = std::make_unique<QOpenGLFramebufferObject>(size, QOpenGLFramebufferObject::NoAttachment);
+    if (!m_sum->isValid() || !m_output->isValid()) {
+        qWarning("GpuFrameAccumulator: Invalid target fbo");
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void GpuFrameAccumulator::destroy()
+{
+    m_output.reset();
+    m_sum.reset();
+    m_vao.reset();
+    m_program.reset();
+}
+
+void GpuFrameAccumulator::clear()
+{
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    m_sum->bind();
+    f->glDisable(GL_SCISSOR_TEST);
+    f->glClearColor(0, 0, 0, 0);
+    f->glClear(GL_COLOR_BUFFER_BIT);
+    QOpenGLFramebufferObject::bindDefault();
+}
+
+void GpuFrameAccumulator::accumulate(GLuint texture, float weight)
+{
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    f->glEnable(GL_BLEND);
+    f->glBlendEquation(GL_FUNC_ADD);
+    f->glBlendFunc(GL_ONE, GL_ONE);
+    draw(m_sum.get(), texture, weight);
+    f->glDisable(GL_BLEND);
+}
+
+QOpenGLFramebufferObject* GpuFrameAccumulator::resolve()
+{
+    QOpenGLContext::currentContext()->extraFunctions()->glDisable(GL_BLEND);
+    draw(m_output.get(), m_sum->texture(), 1.0f);
+    return m_output.get();
+}
+
+void GpuFrameAccumulator::draw(QOpenGLFramebufferObject* target, GLuint texture, float weight)
+{
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    target->bind();
+    f->glViewport(0, 0, m_size.width(), m_size.height());
+    f->glDisable(GL_DEPTH_TEST);
+    f->glDisable(GL_SCISSOR_TEST);
+    f->glDisable(GL_STENCIL_TEST);
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBindTexture(GL_TEXTURE_2D, texture);
+
+    m_program->bind();
+    m_program->setUniformValue("weight", weight);
+    m_vao->bind();
+    f->glDrawArrays(GL_TRIANGLES, 0, 3);
+    m_vao->release();
+    m_program->release();
+
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    QOpenGLFramebufferObject::bindDefault();
+}
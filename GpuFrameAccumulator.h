@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QSize>
+#include <memory>
+
+// Averages several rendered textures on the GPU, for motion blur from
+// sub-frames. The weighted sum is kept in a half float target, so 8 bit
+// sub-frames add up without banding, and only resolve() converts the average
+// back to rgba8 for readback. All targets are bottom-up like the source.
+// Must be created, used and destroyed with the same context current.
+class GpuFrameAccumulator {
+public:
+    GpuFrameAccumulator() = default;
+    ~GpuFrameAccumulator();
+
+    bool create(const QSize& size);
+    void destroy();
+
+    // Starts a new average.
+    void clear();
+    // Adds the premultiplied rgba texture times weight, the weights of one average should add up to 1.
+    void accumulate(GLuint texture, float weight);
+    // Returns the fbo holding the average as rgba8.
+    QOpenGLFramebufferObject* resolve();
+
+private:
+    void draw(QOpenGLFramebufferObject* target, GLuint texture, float weight);
+
+private:
+    QSize m_size;
+    std::unique_ptr<QOpenGLShaderProgram> m_program;
+    std::unique_ptr<QOpenGLVertexArrayObject> m_vao;
+    std::unique_ptr<QOpenGLFramebufferObject> m_sum;
+    std::unique_ptr<QOpenGLFramebufferObject> m_output;
+};
@@ -0,0 +1,149 @@
+#include "GpuYuvConverter.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QVector3D>
+
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+
+// Fullscreen triangle, no vertex buffer needed.
+static const char* vertexShader = R"(#version 150
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Output row r is row r of the I420 buffer: Y rows first, then U and V each
+// packed two chroma rows per output row. The source texture is bottom-up.
+static const char* fragmentShader = R"(#version 150
+uniform sampler2D source;
+uniform ivec2 size;
+uniform vec3 yCoefficients;
+uniform vec3 uCoefficients;
+uniform vec3 vCoefficients;
+uniform float yOffset;
+out vec4 fragColor;
+
+vec3 rgbAt(ivec2 position)
+{
+    return texelFetch(source, ivec2(position.x, size.y - 1 - position.y), 0).rgb;
+}
+
+void main()
+{
+    ivec2 position = ivec2(gl_FragCoord.xy);
+    float value;
+    if (position.y < size.y) {
+        value = dot(yCoefficients, rgbAt(position)) + yOffset;
+    } else {
+        int chromaWidth = size.x / 2;
+        int planeSize = chromaWidth * (size.y / 2);
+        int index = (position.y - size.y) * size.x + position.x;
+        int plane = index / planeSize;
+        index -= plane * planeSize;
+        ivec2 block = ivec2(index % chromaWidth, index / chromaWidth) * 2;
+        vec3 rgb = (rgbAt(block) + rgbAt(block + ivec2(1, 0)) + rgbAt(block + ivec2(0, 1)) + rgbAt(block + ivec2(1, 1))) * 0.25;
+        value = dot(plane == 0 ? uCoefficients : vCoefficients, rgb) + 0.5;
+    }
+    fragColor = vec4(value, 0.0, 0.0, 1.0);
+}
+)";
+
+GpuYuvConverter::~GpuYuvConverter()
+{
+    destroy();
+}
+
+bool GpuYuvConverter::isSupportedSize(const QSize& size)
+{
+    return size.width() % 2 == 0 && size.height() % 4 == 0;
+}
+
+bool GpuYuvConverter::create(const QSize& size, bool fullRange)
+{
+    if (!isSupportedSize(size)) {
+        qWarning() << "GpuYuvConverter: Unsupported size" << size;
+        return false;
+    }
+    m_size = size;
+
+    m_program = std::make_unique<QOpenGLShaderProgram>();
+    if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader)
+        || !m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader)
+        || !m_program->link()) {
+        qWarning() << "GpuYuvConverter: Unable to build shader" << m_program->log();
+        destroy();
+        return false;
+    }
+
+    // BT.709, Kr = 0.2126, Kb = 0.0722
+    const float lumaScale = fullRange ? 1.0f : 219.0f / 255.0f;
+    const float chromaScale = fullRange ? 1.0f : 224.0f / 255.0f;
+    m_program->bind();
+    m_program->setUniformValue("source", 0);
+    QOpenGLContext::currentContext()->extraFunctions()->glUniform2i(m_program->uniformLocation("size"), m_size.width(), m_size.height());
+    m_program->setUniformValue("yCoefficients", QVector3D(0.2126f, 0.7152f, 0.0722f) * lumaScale);
+    m_program->setUniformValue("uCoefficients", QVector3D(-0.1146f, -0.3854f, 0.5f) * chromaScale);
+    m_program->setUniformValue("vCoefficients", QVector3D(0.5f, -0.4542f, -0.0458f) * chromaScale);
+    m_program->setUniformValue("yOffset", fullRange ? 0.0f : 16.0f / 255.0f);
+    m_program->release();
+
+    m_vao = std::make_unique<QOpenGLVertexArrayObject>();
+    m_vao->create();
+
+    m_target = std::make_unique<QOpenGLFramebufferObject>(
+        outputSize(), QOpenGLFramebufferObject::NoAttachment, GL_TEXTURE_2D, GL_R8);
+    if (!m_target->isValid()) {
+        qWarning("GpuYuvConverter: Invalid target fbo");
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void GpuYuvConverter::destroy()
+{
+    m_target.reset();
+    m_vao.reset();
+    m_program.reset();
+}
+
+QOpenGLFramebufferObject* GpuYuvConverter::convert(GLuint texture)
+{
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    m_target->bind();
+    f->glViewport(0, 0, outputSize().width(), outputSize().height());
+    f->glDisable(GL_BLEND);
+    f->glDisable(GL_DEPTH_TEST);
+    f->glDisable(GL_SCISSOR_TEST);
+    f->glDisable(GL_STENCIL_TEST);
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBindTexture(GL_TEXTURE_2D, texture);
+
+    m_program->bind();
+    m_vao->bind();
+    f->glDrawArrays(GL_TRIANGLES, 0, 3);
+    m_vao->release();
+    m_program->release();
+
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    QOpenGLFramebufferObject::bindDefault();
+    return m_target.get();
+}
+
+QImage GpuYuvConverter::toImage() const
+{
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+
+    // QImage scanlines are 4 byte aligned, the default GL_PACK_ALIGNMENT.
+    QImage image(outputSize(), QImage::Format_Grayscale8);
+    m_target->bind();
+    f->glReadPixels(0, 0, image.width(), image.height(), GL_RED, GL_UNSIGNED_BYTE, image.bits());
+    QOpenGLFramebufferObject::bindDefault();
+    return image;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QImage>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QSize>
+#include <memory>
+
+// Converts the rendered rgba texture into planar yuv 4:2:0 (BT.709) on the
+// GPU. The result is one single channel target of width x height * 3 / 2
+// holding the Y, U and V planes back to back in top-down order, so readback
+// moves 1.5 instead of 4 bytes per pixel and needs no flip.
+// Must be created, used and destroyed with the same context current.
+class GpuYuvConverter {
+public:
+    GpuYuvConverter() = default;
+    ~GpuYuvConverter();
+
+    // The planes only pack into whole rows for even widths and heights divisible by 4.
+    static bool isSupportedSize(const QSize& size);
+
+    bool create(const QSize& size, bool fullRange);
+    void destroy();
+
+    // Returns the fbo holding the planes of the given rgba texture.
+    QOpenGLFramebufferObject* convert(GLuint texture);
+    // Synchronous readback of the last conversion as Format_Grayscale8.
+    QImage toImage() const;
+
+    QSize outputSize() const { return QSize(m_size.width(), m_size.height() * 3 / 2); }
+
+private:
+    QSize m_size;
+    std::unique_ptr<QOpenGLShaderProgram> m_program;
+    std::unique_ptr<QOpenGLVertexArrayObject> m_vao;
+    std::unique_ptr<QOpenGLFramebufferObject> m_target;
+};
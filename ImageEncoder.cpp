@@ -0,0 +1,331 @@
+#include "ImageEncoder.h"
+
+#include <QDebug>
+#include <QImageWriter>
+#include <QtEndian>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+static const char* const pngFilterNames[] = { "none", "sub", "up", "average", "paeth", "adaptive" };
+
+bool ImageEncoder::parseFormat(const QString& outputFormat, QString* format, Options* options)
+{
+    *options = Options();
+    const qsizetype query = outputFormat.indexOf('?');
+    *format = outputFormat.left(query);
+    if (query < 0)
+        return true;
+
+    bool valid = true;
+    bool filterSet = false;
+    for (const QString& option : outputFormat.mid(query + 1).split('&', Qt::SkipEmptyParts)) {
+        const QString key = option.section('=', 0, 0);
+        const QString value = option.section('=', 1);
+        bool ok = false;
+        if (key == "quality") {
+            options->quality = qBound(0, value.toInt(&ok), 100);
+        } else if (key == "level") {
+            options->pngLevel = qBound(0, value.toInt(&ok), 9);
+        } else if (key == "filter") {
+            for (int filter = 0; filter <= int(PngFilter::Adaptive); ++filter) {
+                if (value == pngFilterNames[filter]) {
+                    options->pngFilter = PngFilter(filter);
+                    filterSet = ok = true;
+                }
+            }
+        }
+        if (!ok) {
+            qWarning() << "Ignoring option" << option << "of output format" << outputFormat;
+            valid = false;
+        }
+    }
+    // A filter alone also selects the built in writer, at zlib's default level.
+    if (filterSet && options->pngLevel < 0)
+        options->pngLevel = 6;
+    return valid;
+}
+
+bool ImageEncoder::write(const QImage& image, QIODevice* device, const QString& format, const Options& options)
+{
+    if (format == "qoi")
+        return writeQoi(image, device);
+    if (format == "tga")
+        return writeTga(image, device);
+    if (format == "png" && options.pngLevel >= 0)
+        return writePng(image, device, options.pngLevel, options.pngFilter);
+
+    QImageWriter writer(device, format.toLatin1());
+    if (options.quality >= 0)
+        writer.setQuality(options.quality);
+    return writer.write(image);
+}
+
+static quint32 crc32(quint32 crc, const uchar* data, qsizetype size)
+{
+    static const std::array<quint32, 256> table = []() {
+        std::array<quint32, 256> table {};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 value = i;
+            for (int bit = 0; bit < 8; ++bit)
+                value = value & 1 ? 0xedb88320 ^ (value >> 1) : value >> 1;
+            table[i] = value;
+        }
+        return table;
+    }();
+    for (qsizetype i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+static bool writePngChunk(QIODevice* device, const char* type, const char* data, qsizetype size)
+{
+    uchar length[4];
+    qToBigEndian<quint32>(quint32(size), length);
+    quint32 crc = crc32(0xffffffff, reinterpret_cast<const uchar*>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const uchar*>(data), size);
+    uchar checksum[4];
+    qToBigEndian<quint32>(crc ^ 0xffffffff, checksum);
+    return device->write(reinterpret_cast<const char*>(length), 4) == 4
+        && device->write(type, 4) == 4
+        && device->write(data, size) == size
+        && device->write(reinterpret_cast<const char*>(checksum), 4) == 4;
+}
+
+static inline uchar paethPredictor(int left, int up, int upLeft)
+{
+    const int estimate = left + up - upLeft;
+    const int distanceLeft = std::abs(estimate - left);
+    const int distanceUp = std::abs(estimate - up);
+    const int distanceUpLeft = std::abs(estimate - upLeft);
+    if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+        return uchar(left);
+    return uchar(distanceUp <= distanceUpLeft ? up : upLeft);
+}
+
+// Filters one row of size bytes against the previous one (zeros for the first row).
+static void filterPngRow(ImageEncoder::PngFilter filter, const uchar* row, const uchar* previous, qsizetype size, int channels, uchar* out)
+{
+    switch (filter) {
+    case ImageEncoder::PngFilter::None:
+    case ImageEncoder::PngFilter::Adaptive:
+        memcpy(out, row, size);
+        break;
+    case ImageEncoder::PngFilter::Sub:
+        for (qsizetype i = 0; i < size; ++i)
+            out[i] = uchar(row[i] - (i >= channels ? row[i - channels] : 0));
+        break;
+    case ImageEncoder::PngFilter::Up:
+        for (qsizetype i = 0; i < size; ++i)
+            out[i] = uchar(row[i] - previous[i]);
+        break;
+    case ImageEncoder::PngFilter::Average:
+        for (qsizetype i = 0; i < size; ++i)
+            out[i] = uchar(row[i] - ((i >= channels ? row[i - channels] : 0) + previous[i]) / 2);
+        break;
+    case ImageEncoder::PngFilter::Paeth:
+        for (qsizetype i = 0; i < size; ++i) {
+            const int left = i >= channels ? row[i - channels] : 0;
+            const int upLeft = i >= channels ? previous[i - channels] : 0;
+            out[i] = uchar(row[i] - paethPredictor(left, previous[i], upLeft));
+        }
+        break;
+    }
+}
+
+bool ImageEncoder::writePng(const QImage& source, QIODevice* device, int level, PngFilter filter)
+{
+    // Straight alpha, which FrameEncoder::preferredImageFormat() hands out for png.
+    const QImage image = source.format() == QImage::Format_ARGB32 ? source : source.convertToFormat(QImage::Format_ARGB32);
+    const int width = image.width();
+    const int height = image.height();
+
+    // Opaque frames are stored as rgb, a quarter less to filter and compress.
+    bool opaque = true;
+    for (int y = 0; y < height && opaque; ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < width; ++x) {
+            if (qAlpha(line[x]) != 255) {
+                opaque = false;
+                break;
+            }
+        }
+    }
+    const int channels = opaque ? 3 : 4;
+    const qsizetype rowSize = qsizetype(width) * channels;
+
+    // Each row is its filter type followed by the filtered bytes.
+    QByteArray filtered((rowSize + 1) * height, Qt::Uninitialized);
+    QByteArray rows(2 * rowSize, 0);
+    uchar* row = reinterpret_cast<uchar*>(rows.data());
+    uchar* previous = row + rowSize;
+    QByteArray candidate(filter == PngFilter::Adaptive ? rowSize : 0, Qt::Uninitialized);
+    for (int y = 0; y < height; ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < width; ++x) {
+            uchar* pixel = row + qsizetype(x) * channels;
+            pixel[0] = uchar(qRed(line[x]));
+            pixel[1] = uchar(qGreen(line[x]));
+            pixel[2] = uchar(qBlue(line[x]));
+            if (!opaque)
+                pixel[3] = uchar(qAlpha(line[x]));
+        }
+
+        uchar* out = reinterpret_cast<uchar*>(filtered.data()) + (rowSize + 1) * y;
+        PngFilter rowFilter = filter;
+        if (filter == PngFilter::Adaptive) {
+            // The filter with the smallest sum of absolute signed bytes, libpng's heuristic.
+            quint64 bestSum = std::numeric_limits<quint64>::max();
+            uchar* scratch = reinterpret_cast<uchar*>(candidate.data());
+            for (int f = int(PngFilter::None); f < int(PngFilter::Adaptive); ++f) {
+                filterPngRow(PngFilter(f), row, previous, rowSize, channels, scratch);
+                quint64 sum = 0;
+                for (qsizetype i = 0; i < rowSize; ++i)
+                    sum += std::abs(int(qint8(scratch[i])));
+                if (sum < bestSum) {
+                    bestSum = sum;
+                    rowFilter = PngFilter(f);
+                }
+            }
+        }
+        out[0] = uchar(rowFilter);
+        filterPngRow(rowFilter, row, previous, rowSize, channels, out + 1);
+        std::swap(row, previous);
+    }
+
+    // qCompress puts the uncompressed size in front of the zlib stream.
+    const QByteArray compressed = qCompress(filtered, level);
+
+    uchar header[13];
+    qToBigEndian<quint32>(width, header);
+    qToBigEndian<quint32>(height, header + 4);
+    header[8] = 8; // bit depth
+    header[9] = opaque ? 2 : 6; // rgb or rgba
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filtering
+    header[12] = 0; // not interlaced
+    static const char signature[8] = { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n' };
+    return device->write(signature, 8) == 8
+        && writePngChunk(device, "IHDR", reinterpret_cast<const char*>(header), sizeof(header))
+        && writePngChunk(device, "IDAT", compressed.constData() + 4, compressed.size() - 4)
+        && writePngChunk(device, "IEND", nullptr, 0);
+}
+
+// https://qoiformat.org/qoi-specification.pdf
+bool ImageEncoder::writeQoi(const QImage& source, QIODevice* device)
+{
+    const QImage image = source.format() == QImage::Format_RGBA8888 ? source : source.convertToFormat(QImage::Format_RGBA8888);
+    const qsizetype pixelCount = qsizetype(image.width()) * image.height();
+
+    // Worst case is an rgba op per pixel.
+    QByteArray data(14 + pixelCount * 5 + 8, Qt::Uninitialized);
+    uchar* out = reinterpret_cast<uchar*>(data.data());
+    memcpy(out, "qoif", 4);
+    qToBigEndian<quint32>(image.width(), out + 4);
+    qToBigEndian<quint32>(image.height(), out + 8);
+    out[12] = 4; // rgba
+    out[13] = 0; // srgb with linear alpha
+    out += 14;
+
+    struct Pixel {
+        uchar r = 0, g = 0, b = 0, a = 0;
+        bool operator==(const Pixel& other) const { return r == other.r && g == other.g && b == other.b && a == other.a; }
+    };
+    Pixel index[64] {};
+    Pixel previous { 0, 0, 0, 255 };
+    int run = 0;
+
+    // Rgba8888 rows are 4 byte aligned, so the pixels are contiguous.
+    const uchar* in = image.constBits();
+    for (qsizetype i = 0; i < pixelCount; ++i, in += 4) {
+        const Pixel pixel { in[0], in[1], in[2], in[3] };
+        if (pixel == previous) {
+            if (++run == 62 || i == pixelCount - 1) {
+                *out++ = uchar(0xc0 | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            *out++ = uchar(0xc0 | (run - 1));
+            run = 0;
+        }
+
+        const int hash = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+        if (index[hash] == pixel) {
+            *out++ = uchar(hash);
+        } else {
+            index[hash] = pixel;
+            if (pixel.a == previous.a) {
+                const qint8 dr = qint8(pixel.r - previous.r);
+                const qint8 dg = qint8(pixel.g - previous.g);
+                const qint8 db = qint8(pixel.b - previous.b);
+                const int drg = dr - dg;
+                const int dbg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    *out++ = uchar(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                } else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7) {
+                    *out++ = uchar(0x80 | (dg + 32));
+                    *out++ = uchar((drg + 8) << 4 | (dbg + 8));
+                } else {
+                    *out++ = 0xfe;
+                    *out++ = pixel.r;
+                    *out++ = pixel.g;
+                    *out++ = pixel.b;
+                }
+            } else {
+                *out++ = 0xff;
+                *out++ = pixel.r;
+                *out++ = pixel.g;
+                *out++ = pixel.b;
+                *out++ = pixel.a;
+            }
+        }
+        previous = pixel;
+    }
+    static const uchar end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    memcpy(out, end, sizeof(end));
+    out += sizeof(end);
+
+    const qsizetype size = out - reinterpret_cast<const uchar*>(data.constData());
+    return device->write(data.constData(), size) == size;
+}
+
+bool ImageEncoder::writeTga(const QImage& source, QIODevice* device)
+{
+    if (source.width() > 0xffff || source.height() > 0xffff) {
+        qWarning() << "ImageEncoder: tga is limited to 65535 pixels, not" << source.size();
+        return false;
+    }
+    // Straight alpha, which FrameEncoder::preferredImageFormat() hands out for tga.
+    const QImage image = source.format() == QImage::Format_ARGB32 ? source : source.convertToFormat(QImage::Format_ARGB32);
+
+    uchar header[18] = {};
+    header[2] = 2; // uncompressed true colour
+    qToLittleEndian<quint16>(image.width(), header + 12);
+    qToLittleEndian<quint16>(image.height(), header + 14);
+    header[16] = 32; // bits per pixel
+    header[17] = 0x28; // 8 alpha bits, top-left origin
+    if (device->write(reinterpret_cast<const char*>(header), sizeof(header)) != sizeof(header))
+        return false;
+
+    // Tga stores bgra, which is how little endian machines lay out ARGB32.
+    const qsizetype rowSize = qsizetype(image.width()) * 4;
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    QByteArray row(rowSize, Qt::Uninitialized);
+#endif
+    for (int y = 0; y < image.height(); ++y) {
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+        const quint32* line = reinterpret_cast<const quint32*>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            qToLittleEndian<quint32>(line[x], row.data() + qsizetype(x) * 4);
+        const char* data = row.constData();
+#else
+        const char* data = reinterpret_cast<const char*>(image.constScanLine(y));
+#endif
+        if (device->write(data, rowSize) != rowSize)
+            return false;
+    }
+    return true;
+}
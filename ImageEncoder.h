@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QIODevice>
+#include <QImage>
+#include <QString>
+
+// Writes frames in the formats QImageWriter is slow at or lacks, as fast
+// lossless intermediates: png with a chosen zlib level and row filter, qoi
+// and uncompressed 32 bit tga. Everything else, and png without a level,
+// goes through QImageWriter. Options follow the output format like a query:
+//  - png?level=1&filter=up   zlib level 0-9 and the filter of every row:
+//    none, sub, up, average, paeth or adaptive (per row, like libpng)
+//  - jpg?quality=90          QImageWriter quality, also for webp
+class ImageEncoder {
+public:
+    enum class PngFilter {
+        None,
+        Sub,
+        Up,
+        Average,
+        Paeth,
+        Adaptive,
+    };
+
+    struct Options {
+        // QImageWriter::setQuality(), -1 keeps the plugin default
+        int quality = -1;
+        // zlib level of the built in png writer, -1 leaves png to QImageWriter
+        int pngLevel = -1;
+        PngFilter pngFilter = PngFilter::Adaptive;
+    };
+
+    // Splits "png?level=1" into the file format and its options. Returns false
+    // for unknown options, which are skipped.
+    static bool parseFormat(const QString& outputFormat, QString* format, Options* options);
+
+    // format is the file suffix, "qoi" and "tga" never use QImageWriter.
+    static bool write(const QImage& image, QIODevice* device, const QString& format, const Options& options);
+
+private:
+    static bool writePng(const QImage& image, QIODevice* device, int level, PngFilter filter);
+    static bool writeQoi(const QImage& image, QIODevice* device);
+    static bool writeTga(const QImage& image, QIODevice* device);
+};
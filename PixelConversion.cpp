@@ -0,0 +1,269 @@
+#include "PixelConversion.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIXELCONVERSION_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PIXELCONVERSION_TARGET_SSE41
+#define PIXELCONVERSION_TARGET_AVX2
+#else
+#define PIXELCONVERSION_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define PIXELCONVERSION_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace PixelConversion {
+
+namespace {
+
+    // Same factors as qUnpremultiply(): (255 * 65536 + a / 2) / a
+    const std::array<quint32, 256> inverseAlpha = []() {
+        std::array<quint32, 256> table {};
+        for (quint32 a = 1; a < 256; ++a)
+            table[a] = (255 * 65536 + a / 2) / a;
+        return table;
+    }();
+
+    inline quint32 unpremultiplyChannel(quint32 channel, quint32 inverse)
+    {
+        return qMin<quint32>(255, (channel * inverse + 0x8000) >> 16);
+    }
+
+    void convertRowScalar(const uchar* src, uchar* dst, qsizetype pixels, Conversion conversion)
+    {
+        const bool swizzle = conversion == Conversion::Swizzle || conversion == Conversion::UnpremultiplySwizzle;
+        const bool unpremultiply = conversion == Conversion::Unpremultiply || conversion == Conversion::UnpremultiplySwizzle;
+        for (qsizetype i = 0; i < pixels; ++i, src += 4, dst += 4) {
+            quint32 r = src[0], g = src[1], b = src[2];
+            const quint32 a = src[3];
+            if (unpremultiply && a != 255) {
+                const quint32 inverse = inverseAlpha[a];
+                r = unpremultiplyChannel(r, inverse);
+                g = unpremultiplyChannel(g, inverse);
+                b = unpremultiplyChannel(b, inverse);
+            }
+            dst[0] = uchar(swizzle ? b : r);
+            dst[1] = uchar(g);
+            dst[2] = uchar(swizzle ? r : b);
+            dst[3] = uchar(a);
+        }
+    }
+
+#ifdef PIXELCONVERSION_X86
+    PIXELCONVERSION_TARGET_SSE41 inline __m128i unpremultiplySse41(__m128i pixels, bool swizzle)
+    {
+        const __m128i mask = _mm_set1_epi32(0xff);
+        const __m128i round = _mm_set1_epi32(0x8000);
+        const __m128i alpha = _mm_srli_epi32(pixels, 24);
+        const __m128i inverse = _mm_setr_epi32(
+            inverseAlpha[_mm_extract_epi32(alpha, 0)], inverseAlpha[_mm_extract_epi32(alpha, 1)],
+            inverseAlpha[_mm_extract_epi32(alpha, 2)], inverseAlpha[_mm_extract_epi32(alpha, 3)]);
+
+        __m128i r = _mm_and_si128(pixels, mask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+        __m128i b = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+        r = _mm_min_epu32(_mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(r, inverse), round), 16), mask);
+        g = _mm_min_epu32(_mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(g, inverse), round), 16), mask);
+        b = _mm_min_epu32(_mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(b, inverse), round), 16), mask);
+        if (swizzle)
+            std::swap(r, b);
+
+        __m128i result = _mm_or_si128(r, _mm_slli_epi32(g, 8));
+        result = _mm_or_si128(result, _mm_slli_epi32(b, 16));
+        return _mm_or_si128(result, _mm_slli_epi32(alpha, 24));
+    }
+
+    PIXELCONVERSION_TARGET_SSE41 void convertRowSse41(const uchar* src, uchar* dst, qsizetype pixels, Conversion conversion)
+    {
+        const bool swizzle = conversion == Conversion::Swizzle || conversion == Conversion::UnpremultiplySwizzle;
+        const bool unpremultiply = conversion == Conversion::Unpremultiply || conversion == Conversion::UnpremultiplySwizzle;
+        const __m128i swizzleMask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+        qsizetype i = 0;
+        for (; i + 4 <= pixels; i += 4) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+            if (unpremultiply)
+                value = unpremultiplySse41(value, swizzle);
+            else if (swizzle)
+                value = _mm_shuffle_epi8(value, swizzleMask);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), value);
+        }
+        convertRowScalar(src + i * 4, dst + i * 4, pixels - i, conversion);
+    }
+
+    PIXELCONVERSION_TARGET_AVX2 inline __m256i unpremultiplyAvx2(__m256i pixels, bool swizzle)
+    {
+        const __m256i mask = _mm256_set1_epi32(0xff);
+        const __m256i round = _mm256_set1_epi32(0x8000);
+        const __m256i alpha = _mm256_srli_epi32(pixels, 24);
+        const __m256i inverse = _mm256_i32gather_epi32(reinterpret_cast<const int*>(inverseAlpha.data()), alpha, 4);
+
+        __m256i r = _mm256_and_si256(pixels, mask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask);
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask);
+        r = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, inverse), round), 16), mask);
+        g = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(g, inverse), round), 16), mask);
+        b = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(b, inverse), round), 16), mask);
+        if (swizzle)
+            std::swap(r, b);
+
+        __m256i result = _mm256_or_si256(r, _mm256_slli_epi32(g, 8));
+        result = _mm256_or_si256(result, _mm256_slli_epi32(b, 16));
+        return _mm256_or_si256(result, _mm256_slli_epi32(alpha, 24));
+    }
+
+    PIXELCONVERSION_TARGET_AVX2 void convertRowAvx2(const uchar* src, uchar* dst, qsizetype pixels, Conversion conversion)
+    {
+        const bool swizzle = conversion == Conversion::Swizzle || conversion == Conversion::UnpremultiplySwizzle;
+        const bool unpremultiply = conversion == Conversion::Unpremultiply || conversion == Conversion::UnpremultiplySwizzle;
+        const __m256i swizzleMask = _mm256_setr_epi8(
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+        qsizetype i = 0;
+        for (; i + 8 <= pixels; i += 8) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+            if (unpremultiply)
+                value = unpremultiplyAvx2(value, swizzle);
+            else if (swizzle)
+                value = _mm256_shuffle_epi8(value, swizzleMask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), value);
+        }
+        convertRowScalar(src + i * 4, dst + i * 4, pixels - i, conversion);
+    }
+#endif
+
+    Level detectLevel()
+    {
+#ifdef PIXELCONVERSION_X86
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        const bool sse41 = info[2] & (1 << 19);
+        const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osAvx) {
+            __cpuidex(info, 7, 0);
+            avx2 = info[1] & (1 << 5);
+        }
+#else
+        __builtin_cpu_init();
+        const bool sse41 = __builtin_cpu_supports("sse4.1");
+        const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        if (avx2)
+            return Level::Avx2;
+        if (sse41)
+            return Level::Sse41;
+#endif
+        return Level::Scalar;
+    }
+
+    std::atomic<Level> currentLevel = supportedLevel();
+
+}
+
+Level supportedLevel()
+{
+    static const Level level = detectLevel();
+    return level;
+}
+
+Level level()
+{
+    return currentLevel;
+}
+
+void setLevel(Level level)
+{
+    currentLevel = qMin(level, supportedLevel());
+}
+
+const char* levelName(Level level)
+{
+    switch (level) {
+    case Level::Avx2:
+        return "avx2";
+    case Level::Sse41:
+        return "sse4.1";
+    case Level::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+Conversion conversionTo(QImage::Format format)
+{
+    // QImage's 32 bit ARGB formats are bgra in memory on little endian.
+    switch (format) {
+    case QImage::Format_ARGB32_Premultiplied:
+        return Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? Conversion::Swizzle : Conversion::Copy;
+    case QImage::Format_ARGB32:
+        return Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? Conversion::UnpremultiplySwizzle : Conversion::Copy;
+    case QImage::Format_RGBA8888:
+        return Conversion::Unpremultiply;
+    default:
+        return Conversion::Copy;
+    }
+}
+
+bool canConvertTo(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_RGBA8888_Premultiplied:
+    case QImage::Format_RGBA8888:
+        return true;
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_ARGB32:
+        return Q_BYTE_ORDER == Q_LITTLE_ENDIAN;
+    default:
+        return false;
+    }
+}
+
+void convertRow(const uchar* src, uchar* dst, qsizetype pixels, Conversion conversion)
+{
+    if (conversion == Conversion::Copy) {
+        std::memcpy(dst, src, pixels * 4);
+        return;
+    }
+    switch (level()) {
+#ifdef PIXELCONVERSION_X86
+    case Level::Avx2:
+        convertRowAvx2(src, dst, pixels, conversion);
+        return;
+    case Level::Sse41:
+        convertRowSse41(src, dst, pixels, conversion);
+        return;
+#endif
+    default:
+        convertRowScalar(src, dst, pixels, conversion);
+        return;
+    }
+}
+
+QImage convertImage(const uchar* src, qsizetype srcStride, const QSize& size, QImage::Format format, bool flip)
+{
+    if (!canConvertTo(format)) {
+        QImage image(size, QImage::Format_RGBA8888_Premultiplied);
+        for (int y = 0; y < size.height(); ++y)
+            std::memcpy(image.scanLine(flip ? size.height() - 1 - y : y), src + y * srcStride, size.width() * 4);
+        return image.convertToFormat(format);
+    }
+
+    QImage image(size, format);
+    const Conversion conversion = conversionTo(format);
+    for (int y = 0; y < size.height(); ++y)
+        convertRow(src + y * srcStride, image.scanLine(flip ? size.height() - 1 - y : y), size.width(), conversion);
+    return image;
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QImage>
+
+// Row kernels for turning read back GL pixels (Format_RGBA8888_Premultiplied)
+// into what the encoders consume, with the vertical flip folded into the same
+// pass. Dispatched at runtime to AVX2 or SSE4.1, with a scalar fallback.
+// Results match qUnpremultiply() bit for bit.
+namespace PixelConversion {
+
+enum class Level {
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+enum class Conversion {
+    Copy,
+    Swizzle, // rgba <-> bgra
+    Unpremultiply,
+    UnpremultiplySwizzle,
+};
+
+Level supportedLevel();
+Level level();
+// Lowers the level used by convertRow(), mainly for benchmarks. Clamped to supportedLevel().
+void setLevel(Level level);
+const char* levelName(Level level);
+
+// Conversion from Format_RGBA8888_Premultiplied to format, Copy for unsupported formats.
+Conversion conversionTo(QImage::Format format);
+bool canConvertTo(QImage::Format format);
+
+void convertRow(const uchar* src, uchar* dst, qsizetype pixels, Conversion conversion);
+
+// Converts height rows of premultiplied rgba starting at src into an image of
+// the given format, flipping bottom-up GL rows when flip is set.
+QImage convertImage(const uchar* src, qsizetype srcStride, const QSize& size, QImage::Format format, bool flip);
+
+}
@@ -0,0 +1,59 @@
+// Copyright (C) The Qt Company Ltd.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QRandomGenerator>
+
+#include "PixelConversion.h"
+
+// Compares the readback post processing (flip + unpremultiply + swizzle) of
+// QImage::mirrored().convertToFormat() against the PixelConversion kernels.
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const QSize size(3840, 2160);
+    const int iterations = app.arguments().size() > 1 ? app.arguments().at(1).toInt() : 20;
+
+    // Premultiplied rgba as it comes out of glReadPixels, with varying alpha.
+    QByteArray pixels(qsizetype(size.width()) * size.height() * 4, Qt::Uninitialized);
+    auto* data = reinterpret_cast<uchar*>(pixels.data());
+    QRandomGenerator random(42);
+    for (qsizetype i = 0; i < pixels.size(); i += 4) {
+        const uint alpha = random.bounded(256);
+        data[i + 0] = uchar(random.bounded(alpha + 1));
+        data[i + 1] = uchar(random.bounded(alpha + 1));
+        data[i + 2] = uchar(random.bounded(alpha + 1));
+        data[i + 3] = uchar(alpha);
+    }
+    const QImage source(data, size.width(), size.height(), size.width() * 4, QImage::Format_RGBA8888_Premultiplied);
+
+    const QList<QImage::Format> formats = { QImage::Format_ARGB32, QImage::Format_ARGB32_Premultiplied, QImage::Format_RGBA8888 };
+    for (const QImage::Format format : formats) {
+        QElapsedTimer timer;
+        timer.start();
+        QImage reference;
+        for (int i = 0; i < iterations; ++i)
+            reference = source.mirrored().convertToFormat(format);
+        const double qimageMs = double(timer.nsecsElapsed()) / iterations / 1e6;
+        qInfo().noquote() << QString("format %1  %2: %3 ms/frame").arg(int(format)).arg("qimage", -8).arg(qimageMs, 0, 'f', 2);
+
+        for (int level = int(PixelConversion::supportedLevel()); level >= 0; --level) {
+            PixelConversion::setLevel(PixelConversion::Level(level));
+            timer.restart();
+            QImage converted;
+            for (int i = 0; i < iterations; ++i)
+                converted = PixelConversion::convertImage(data, size.width() * 4, size, format, true);
+            const double ms = double(timer.nsecsElapsed()) / iterations / 1e6;
+            qInfo().noquote() << QString("format %1  %2: %3 ms/frame  %4x%5")
+                                     .arg(int(format))
+                                     .arg(PixelConversion::levelName(PixelConversion::Level(level)), -8)
+                                     .arg(ms, 0, 'f', 2)
+                                     .arg(qimageMs / ms, 0, 'f', 1)
+                                     .arg(converted == reference ? "" : "  MISMATCH");
+        }
+    }
+    return 0;
+}
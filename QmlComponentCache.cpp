@@ -0,0 +1,79 @@
+#include "QmlComponentCache.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+
+QmlComponentCache::QmlComponentCache(QQmlEngine* engine)
+    : m_engine(engine)
+{
+}
+
+QmlComponentCache::~QmlComponentCache()
+{
+    clear();
+}
+
+QQmlComponent* QmlComponentCache::component(const QString& qmlFile, bool* cached)
+{
+    const QUrl url = QUrl::fromUserInput(qmlFile);
+    const QString key = fingerprint(url);
+
+    auto it = m_entries.find(url);
+    if (it != m_entries.end() && it->fingerprint == key) {
+        if (cached)
+            *cached = true;
+        return it->component;
+    }
+    if (cached)
+        *cached = false;
+
+    if (it != m_entries.end()) {
+        // The engine's type cache still holds the old file and whatever imported it.
+        clear();
+        m_engine->clearComponentCache();
+    }
+
+    auto* component = new QQmlComponent(m_engine, url, QQmlComponent::PreferSynchronous);
+    m_entries.insert(url, { key, component });
+    return component;
+}
+
+void QmlComponentCache::clear()
+{
+    for (const Entry& entry : std::as_const(m_entries))
+        delete entry.component;
+    m_entries.clear();
+}
+
+QString QmlComponentCache::fingerprint(const QUrl& url)
+{
+    if (!url.isLocalFile())
+        return url.toString();
+
+    const QFileInfo file(url.toLocalFile());
+    QString key;
+    const QFileInfoList siblings = file.absoluteDir().entryInfoList({ "*.qml", "*.js", "*.mjs", "qmldir" }, QDir::Files, QDir::Name);
+    for (const QFileInfo& sibling : siblings)
+        key += QString("%1:%2:%3;").arg(sibling.fileName()).arg(sibling.size()).arg(sibling.lastModified().toMSecsSinceEpoch());
+    return key;
+}
+
+int QmlComponentCache::precompile(const QString& directory)
+{
+    QQmlEngine engine;
+    int compiled = 0;
+    QDirIterator it(directory, { "*.qml" }, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString fileName = it.next();
+        QQmlComponent component(&engine, QUrl::fromLocalFile(fileName), QQmlComponent::PreferSynchronous);
+        if (component.isError()) {
+            qWarning() << "Unable to compile:" << fileName << component.errorString();
+            continue;
+        }
+        compiled++;
+    }
+    return compiled;
+}
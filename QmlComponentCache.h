@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QHash>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QString>
+
+// Keeps the compiled components of one QQmlEngine across jobs, so a reused
+// render job doesn't parse and compile the same template again. Entries are
+// keyed by the file and the size and mtime of the QML and JS files next to it,
+// which covers its implicit imports.
+class QmlComponentCache {
+public:
+    explicit QmlComponentCache(QQmlEngine* engine);
+    ~QmlComponentCache();
+
+    // Returns the component for qmlFile, compiling it only when it changed on
+    // disk. Owned by the cache, check isError() before use.
+    QQmlComponent* component(const QString& qmlFile, bool* cached = nullptr);
+    void clear();
+
+    // Compiles every .qml file below directory once, which stores them in Qt's
+    // QML disk cache (.qmlc) for all later processes. Returns the number of
+    // files compiled without errors.
+    static int precompile(const QString& directory);
+
+private:
+    static QString fingerprint(const QUrl& url);
+
+private:
+    struct Entry {
+        QString fingerprint;
+        QQmlComponent* component = nullptr;
+    };
+    QQmlEngine* m_engine = nullptr;
+    QHash<QUrl, Entry> m_entries;
+};
@@ -0,0 +1,370 @@
+// Copyright (C) The Qt Company Ltd.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include "FrameProfiler.h"
+#include "ImageEncoder.h"
+#include "MovieRenderer.h"
+#include "RenderJobOpenGl.h"
+#include "RenderJobSoftware.h"
+
+// Synthetic scenes covering the typical cost centers of a render. Each fills
+// the root item, which the job sizes to the output resolution.
+struct Scene {
+    const char* name;
+    const char* qml;
+    // Renders with the software backend, which has no shader effects or particles
+    bool software = true;
+};
+
+static const Scene scenes[] = {
+    { "static", R"(
+import QtQuick
+Rectangle {
+    color: "#203040"
+    Text { anchors.centerIn: parent; text: "Static"; font.pixelSize: parent.height / 8; color: "white" }
+})" },
+    { "text", R"(
+import QtQuick
+Rectangle {
+    id: root
+    color: "black"
+    Repeater {
+        model: 300
+        Text {
+            x: (index % 15) * root.width / 15
+            y: Math.floor(index / 15) * root.height / 20
+            text: "Lorem ipsum " + index
+            color: Qt.hsla(index / 300, 0.6, 0.6, 1)
+            font.pixelSize: root.height / 30
+            NumberAnimation on rotation { from: 0; to: 360; duration: 2000; loops: Animation.Infinite }
+        }
+    }
+})" },
+    { "rectangles", R"(
+import QtQuick
+Rectangle {
+    id: root
+    color: "white"
+    Repeater {
+        model: 2000
+        Rectangle {
+            width: root.width / 40; height: width
+            radius: width / 4
+            color: Qt.hsla((index % 97) / 97, 0.7, 0.5, 0.8)
+            x: (index * 37) % root.width
+            NumberAnimation on y { from: 0; to: root.height; duration: 1000 + index % 1000; loops: Animation.Infinite }
+        }
+    }
+})" },
+    { "images", R"(
+import QtQuick
+Rectangle {
+    id: root
+    color: "black"
+    Repeater {
+        model: 64
+        Image {
+            source: "image" + (index % 8) + ".png"
+            width: root.width / 8; height: root.height / 8
+            x: (index % 8) * width; y: Math.floor(index / 8) * height
+            smooth: true
+            NumberAnimation on scale { from: 0.5; to: 1.5; duration: 1500; loops: Animation.Infinite }
+        }
+    }
+})" },
+    { "shaders", R"(
+import QtQuick
+import QtQuick.Effects
+Rectangle {
+    id: root
+    color: "#101010"
+    Repeater {
+        model: 6
+        Item {
+            width: root.width / 3; height: root.height / 2
+            x: (index % 3) * width; y: Math.floor(index / 3) * height
+            Image { id: source; anchors.fill: parent; source: "image" + index + ".png"; visible: false }
+            MultiEffect {
+                anchors.fill: parent
+                source: source
+                blurEnabled: true
+                blurMax: 64
+                shadowEnabled: true
+                colorization: 0.5
+                NumberAnimation on blur { from: 0; to: 1; duration: 2000; loops: Animation.Infinite }
+            }
+        }
+    }
+})",
+        false },
+    { "particles", R"(
+import QtQuick
+import QtQuick.Particles
+Rectangle {
+    id: root
+    color: "black"
+    ParticleSystem { id: system }
+    ImageParticle { system: system; source: "image0.png"; colorVariation: 0.5; alpha: 0.5 }
+    Emitter {
+        system: system
+        anchors.centerIn: parent
+        emitRate: 2000; lifeSpan: 2000
+        size: root.height / 40; sizeVariation: size / 2
+        velocity: AngleDirection { angleVariation: 360; magnitude: root.height / 4; magnitudeVariation: magnitude / 2 }
+    }
+})",
+        false },
+};
+
+static void writeImages(const QDir& directory)
+{
+    QRandomGenerator random(1);
+    for (int i = 0; i < 8; ++i) {
+        QImage image(512, 512, QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+        QLinearGradient gradient(0, 0, 512, 512);
+        gradient.setColorAt(0, QColor::fromHsv(i * 45, 200, 255));
+        gradient.setColorAt(1, QColor::fromHsv((i * 45 + 120) % 360, 200, 80));
+        painter.fillRect(image.rect(), gradient);
+        for (int c = 0; c < 40; ++c) {
+            painter.setBrush(QColor::fromRgb(random.generate()));
+            painter.drawEllipse(QPoint(random.bounded(512), random.bounded(512)), 30, 30);
+        }
+        painter.end();
+        image.save(directory.filePath(QString("image%1.png").arg(i)));
+    }
+}
+
+static QString glRenderer()
+{
+    QOffscreenSurface surface;
+    surface.create();
+    QOpenGLContext context;
+    if (!context.create() || !context.makeCurrent(&surface))
+        return QString();
+    const QString renderer = reinterpret_cast<const char*>(context.functions()->glGetString(GL_RENDERER));
+    context.doneCurrent();
+    return renderer;
+}
+
+struct Result {
+    int frames = 0;
+    double seconds = 0;
+    QJsonObject stages;
+};
+
+// Sums of all runs of one output format
+struct FormatTotals {
+    int frames = 0;
+    double seconds = 0;
+    double encodeMs = 0;
+    int encodedImages = 0;
+    qint64 bytes = 0;
+};
+
+static qint64 directorySize(const QString& path)
+{
+    qint64 size = 0;
+    QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        size += it.nextFileInfo().size();
+    return size;
+}
+
+template <typename Job>
+static Result renderScene(const QString& qmlFile, const QString& name, const QSize& size, const QString& format,
+    const QString& outputDirectory, qreal fps, int duration)
+{
+    Job job;
+    job.m_qmlFile = qmlFile;
+    job.m_size = size;
+    job.m_dpr = 1;
+    job.m_fps = fps;
+    job.m_duration = duration;
+    job.m_outputName = name;
+    job.m_outputDirectory = outputDirectory;
+    ImageEncoder::parseFormat(format, &job.m_outputFormat, &job.m_imageOptions);
+    if (!job.init())
+        return {};
+
+    QElapsedTimer timer;
+    timer.start();
+    job.start();
+    job.waitForFinished();
+    return { job.m_endFrame - job.m_startFrame, timer.nsecsElapsed() / 1e9, job.profiler().toJson() };
+}
+
+// Renders every scene at every size into every format with RenderJobOpenGl
+// (or RenderJobSoftware with --software) on the gui thread and reports
+// frames/s and per stage times as JSON, followed by a table of throughput,
+// encode time and size per output format.
+int main(int argc, char* argv[])
+{
+    // Pass --llvmpipe on CPU only machines, Mesa reads these before the first context.
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--llvmpipe") == 0) {
+            qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+            qputenv("GALLIUM_DRIVER", "llvmpipe");
+        }
+    }
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("QmlOffscreenRendererBenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders synthetic QML scenes and reports throughput as JSON.");
+    parser.addHelpOption();
+    const QCommandLineOption scenesOption("scenes", "Comma separated scenes: static, text, rectangles, images, shaders, particles.", "names");
+    const QCommandLineOption sizesOption("sizes", "Comma separated WIDTHxHEIGHT list.", "sizes", "640x360,1280x720,1920x1080");
+    const QCommandLineOption formatsOption("formats", "Comma separated output formats.", "formats", "png,png?level=1&filter=up,qoi,tga,ppm,jpg?quality=90,y4m");
+    const QCommandLineOption durationOption("duration", "Duration per run in milliseconds.", "ms", "2000");
+    const QCommandLineOption fpsOption("fps", "Frames per second.", "fps", "30");
+    const QCommandLineOption outputOption({ "o", "output" }, "Write the JSON report to a file instead of stdout.", "file");
+    const QCommandLineOption llvmpipeOption("llvmpipe", "Force Mesa's llvmpipe software rasterizer.");
+    const QCommandLineOption softwareOption("software", "Render with the Qt Quick software backend instead of OpenGL.");
+    parser.addOptions({ scenesOption, sizesOption, formatsOption, durationOption, fpsOption, outputOption, llvmpipeOption, softwareOption });
+    parser.process(app);
+    const bool software = parser.isSet(softwareOption);
+    MovieRenderer::selectGraphicsApi(software);
+
+    QStringList sceneNames = parser.value(scenesOption).split(',', Qt::SkipEmptyParts);
+    if (sceneNames.isEmpty()) {
+        for (const Scene& scene : scenes)
+            sceneNames.append(scene.name);
+    }
+    QList<QSize> sizes;
+    for (const QString& size : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        const QStringList parts = size.split('x');
+        if (parts.size() == 2)
+            sizes.append(QSize(parts[0].toInt(), parts[1].toInt()));
+    }
+    const QStringList formats = parser.value(formatsOption).split(',', Qt::SkipEmptyParts);
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        qWarning("Unable to create a temporary directory");
+        return 1;
+    }
+    const QDir sceneDirectory(directory.path());
+    writeImages(sceneDirectory);
+
+    FrameProfiler::setEnabled(true);
+    QJsonArray results;
+    QHash<QString, FormatTotals> formatTotals;
+    for (const Scene& scene : scenes) {
+        if (!sceneNames.contains(scene.name))
+            continue;
+        if (software && !scene.software) {
+            qInfo() << "Skipping" << scene.name << "with the software backend";
+            continue;
+        }
+        const QString qmlFile = sceneDirectory.filePath(QString("%1.qml").arg(scene.name));
+        QFile file(qmlFile);
+        if (!file.open(QIODevice::WriteOnly) || file.write(scene.qml) < 0) {
+            qWarning() << "Unable to write:" << qmlFile;
+            return 1;
+        }
+        file.close();
+
+        for (const QSize& size : std::as_const(sizes)) {
+            for (const QString& format : formats) {
+                const QString outputDirectory = sceneDirectory.filePath(QString("%1_%2x%3_%4").arg(scene.name).arg(size.width()).arg(size.height()).arg(QString(format).replace(QRegularExpression("[^A-Za-z0-9]"), "_")));
+                QDir().mkpath(outputDirectory);
+
+                const qreal fps = parser.value(fpsOption).toDouble();
+                const int duration = parser.value(durationOption).toInt();
+                const Result result = software
+                    ? renderScene<RenderJobSoftware>(qmlFile, scene.name, size, format, outputDirectory, fps, duration)
+                    : renderScene<RenderJobOpenGl>(qmlFile, scene.name, size, format, outputDirectory, fps, duration);
+                const double seconds = result.seconds;
+                const int frames = result.frames;
+                const qint64 bytes = directorySize(outputDirectory);
+                const QJsonObject encode = result.stages.value("encode").toObject();
+
+                FormatTotals& totals = formatTotals[format];
+                totals.frames += frames;
+                totals.seconds += seconds;
+                totals.encodeMs += encode.value("mean").toDouble() * encode.value("count").toInt();
+                totals.encodedImages += encode.value("count").toInt();
+                totals.bytes += bytes;
+
+                results.append(QJsonObject {
+                    { "scene", scene.name },
+                    { "width", size.width() },
+                    { "height", size.height() },
+                    { "format", format },
+                    { "frames", frames },
+                    { "seconds", seconds },
+                    { "fps", seconds > 0 ? frames / seconds : 0 },
+                    { "bytes", bytes },
+                    { "stages", result.stages },
+                });
+                qInfo().noquote() << QString("%1 %2x%3 %4: %5 fps").arg(scene.name).arg(size.width()).arg(size.height()).arg(format).arg(seconds > 0 ? frames / seconds : 0, 0, 'f', 1);
+
+                // Only the numbers are kept, frames of large runs add up quickly.
+                QDir(outputDirectory).removeRecursively();
+            }
+        }
+    }
+
+    // Frames of all scenes and sizes, so the rows compare the formats on the same work.
+    QJsonArray formatResults;
+    qInfo().noquote() << QString("%1 %2 %3 %4").arg("format", -24).arg("fps", 8).arg("encode ms", 10).arg("MB/frame", 9);
+    for (const QString& format : formats) {
+        const FormatTotals totals = formatTotals.value(format);
+        if (totals.frames == 0)
+            continue;
+        const double fps = totals.seconds > 0 ? totals.frames / totals.seconds : 0;
+        const double encodeMs = totals.encodedImages > 0 ? totals.encodeMs / totals.encodedImages : 0;
+        const double mbPerFrame = totals.bytes / 1e6 / totals.frames;
+        formatResults.append(QJsonObject {
+            { "format", format },
+            { "frames", totals.frames },
+            { "fps", fps },
+            { "encodeMs", encodeMs },
+            { "mbPerFrame", mbPerFrame },
+        });
+        qInfo().noquote() << QString("%1 %2 %3 %4").arg(format, -24).arg(fps, 8, 'f', 1).arg(encodeMs, 10, 'f', 2).arg(mbPerFrame, 9, 'f', 2);
+    }
+
+    const QJsonObject report {
+        { "qtVersion", qVersion() },
+        { "backend", software ? "software" : "opengl" },
+        { "glRenderer", software ? QString() : glRenderer() },
+        { "platform", QGuiApplication::platformName() },
+        { "results", results },
+        { "formats", formatResults },
+    };
+    const QByteArray json = QJsonDocument(report).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) || output.write(json) != json.size()) {
+            qWarning() << "Unable to write:" << parser.value(outputOption);
+            return 1;
+        }
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
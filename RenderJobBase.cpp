@@ -0,0 +1,219 @@
+// Copyright (C) The Qt Company Ltd.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "RenderJobBase.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QUrl>
+
+RenderJobBase::RenderJobBase(QObject* owner)
+    : m_scheduler(owner)
+{
+}
+
+void RenderJobBase::createEngine(QQuickWindow* window)
+{
+    m_qmlEngine = new QQmlEngine();
+    if (!m_qmlEngine->incubationController())
+        m_qmlEngine->setIncubationController(window->incubationController());
+    m_componentCache = new QmlComponentCache(m_qmlEngine);
+
+    m_frameEncoder = new FrameEncoder();
+    m_frameEncoder->setWorkerCount(m_encoderThreads);
+    m_frameEncoder->setMaxQueueDepth(m_encoderQueueDepth);
+    m_frameEncoder->setProfiler(&m_profiler);
+}
+
+void RenderJobBase::destroyEngine()
+{
+    delete m_rootItem;
+    m_rootItem = nullptr;
+    delete m_componentCache;
+    m_componentCache = nullptr;
+    m_qmlComponent = nullptr;
+    delete m_qmlEngine;
+    m_qmlEngine = nullptr;
+    delete m_frameEncoder;
+    m_frameEncoder = nullptr;
+}
+
+bool RenderJobBase::loadQml(QQuickWindow* window)
+{
+    // A reused job still shows the previous scene.
+    delete m_rootItem;
+    m_rootItem = nullptr;
+    QElapsedTimer timer;
+    timer.start();
+    // Only compiled again when the file or its neighbours changed.
+    bool cached = false;
+    m_qmlComponent = m_componentCache->component(m_qmlFile, &cached);
+
+    if (m_qmlComponent->isError()) {
+        const QList<QQmlError> errorList = m_qmlComponent->errors();
+        for (const QQmlError& error : errorList)
+            qWarning() << error.url() << error.line() << error;
+        return false;
+    }
+
+    QObject* rootObject = m_qmlComponent->createWithInitialProperties(m_initialProperties);
+    if (m_qmlComponent->isError()) {
+        const QList<QQmlError> errorList = m_qmlComponent->errors();
+        for (const QQmlError& error : errorList)
+            qWarning() << error.url() << error.line() << error;
+        return false;
+    }
+
+    m_rootItem = qobject_cast<QQuickItem*>(rootObject);
+    if (!m_rootItem) {
+        qWarning("loadQml: Not a QQuickItem");
+        delete rootObject;
+        return false;
+    }
+
+    // The root item is ready. Associate it with the window.
+    m_rootItem->setParentItem(window->contentItem());
+    m_rootItem->setWidth(m_size.width());
+    m_rootItem->setHeight(m_size.height());
+
+    window->setGeometry(0, 0, m_size.width(), m_size.height());
+    qInfo().noquote() << QString("Loaded %1 in %2 ms (%3)").arg(m_qmlFile).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1).arg(cached ? "cached component" : "compiled");
+    return true;
+}
+
+void RenderJobBase::initFrameRange(const FrameRate& frameRate)
+{
+    m_frames = frameRate.frameCount(m_duration);
+    m_startFrame = qBound(0, m_startFrame, m_frames);
+    m_endFrame = m_endFrame < 0 ? m_frames : qBound(m_startFrame, m_endFrame, m_frames);
+}
+
+bool RenderJobBase::openOutput(const FrameRate& frameRate)
+{
+    if (FrameStream::isStreamFormat(m_outputFormat) && !openStream(frameRate)) {
+        qWarning("Unable to open output stream");
+        return false;
+    }
+    if (FrameArchive::isArchiveFormat(m_outputFormat) && !openArchive(frameRate)) {
+        qWarning("Unable to open frame archive");
+        return false;
+    }
+    return true;
+}
+
+void RenderJobBase::prepareRender()
+{
+    // Settings may have changed since the encoder was created when the job is reused.
+    m_frameEncoder->setWorkerCount(m_encoderThreads);
+    m_frameEncoder->setMaxQueueDepth(m_encoderQueueDepth);
+    m_frameEncoder->reset();
+    m_frameEncoder->setDeduplicate(m_deduplicateFrames);
+    m_frameEncoder->setImageOptions(m_imageOptions);
+    m_frameEncoder->setMetrics(m_metrics);
+    m_profiler.clear();
+    m_currentFrame = m_startFrame;
+    m_lastRenderedFrame = -1;
+    m_skippedFrames = 0;
+    m_duplicateFrames.clear();
+    m_sceneDirty = true;
+}
+
+void RenderJobBase::closeOutput(bool writeIndex)
+{
+    // Let the encoder workers drain before the job is considered done.
+    m_frameEncoder->waitForFinished();
+    if (m_deduplicateFrames && writeIndex)
+        writeHashIndex();
+    if (!m_profiler.isEmpty())
+        writeProfile();
+    if (m_frameStream) {
+        m_frameEncoder->setStream(nullptr);
+        delete m_frameStream;
+        m_frameStream = nullptr;
+    }
+    if (m_frameArchive) {
+        m_frameEncoder->setArchive(nullptr);
+        delete m_frameArchive;
+        m_frameArchive = nullptr;
+    }
+}
+
+void RenderJobBase::enqueueFrames(const QImage& image, const QList<int>& frames)
+{
+    // Encoding and writing happen on the encoder pool, only blocks when the queue is full.
+    if (m_frameArchive) {
+        m_frameEncoder->enqueue(image, frames);
+        return;
+    }
+    QStringList outputFiles;
+    for (const int frame : frames)
+        outputFiles.append(outputFile(frame));
+    m_frameEncoder->enqueue(image, outputFiles);
+}
+
+int RenderJobBase::rangePercent(int frames) const
+{
+    return int(qint64(frames) * 100 / qMax(1, m_endFrame - m_startFrame));
+}
+
+QString RenderJobBase::outputFile(int frameNumber) const
+{
+    // Streams take the frame once per entry, the name is not needed.
+    if (m_frameStream)
+        return QString();
+    QString outputFile(m_outputDirectory + QDir::separator() + m_outputName + "_" + QString::number(frameNumber) + "." + m_outputFormat);
+    return QUrl::fromUserInput(outputFile).toLocalFile();
+}
+
+QString RenderJobBase::rangeName() const
+{
+    // Shards only see their own range, so each writes its own files.
+    if (m_startFrame > 0 || m_endFrame < m_frames)
+        return m_outputName + "_" + QString::number(m_startFrame + 1) + "-" + QString::number(m_endFrame);
+    return m_outputName;
+}
+
+void RenderJobBase::writeProfile()
+{
+    const QString traceFile(m_outputDirectory + QDir::separator() + rangeName() + ".trace.json");
+    m_profiler.writeChromeTrace(QUrl::fromUserInput(traceFile).toLocalFile());
+    qInfo().noquote() << "Frame timings of" << rangeName() << "in ms, trace written to" << traceFile << "\n"
+                      << m_profiler.summary();
+}
+
+void RenderJobBase::writeHashIndex()
+{
+    const QString indexFile(m_outputDirectory + QDir::separator() + rangeName() + ".xxh64");
+    m_frameEncoder->writeHashIndex(QUrl::fromUserInput(indexFile).toLocalFile());
+    if (m_frameEncoder->duplicateFrames() > 0)
+        qInfo() << "Linked" << m_frameEncoder->duplicateFrames() << "duplicate frames";
+}
+
+bool RenderJobBase::openStream(const FrameRate& frameRate)
+{
+    QString outputFile(m_outputDirectory + QDir::separator() + m_outputName + "." + (m_outputFormat == "pipe" ? "y4m" : m_outputFormat));
+    m_frameStream = new FrameStream();
+    m_frameStream->setFullRange(m_yuvFullRange);
+    if (!m_frameStream->open(m_outputFormat, QUrl::fromUserInput(outputFile).toLocalFile(), m_streamCommand, m_size * m_dpr, frameRate)) {
+        delete m_frameStream;
+        m_frameStream = nullptr;
+        return false;
+    }
+    m_frameEncoder->setStream(m_frameStream);
+    return true;
+}
+
+bool RenderJobBase::openArchive(const FrameRate& frameRate)
+{
+    // Shards write one archive each, named after their range.
+    const QString archiveFile(m_outputDirectory + QDir::separator() + rangeName() + "." + FrameArchive::fileSuffix());
+    m_frameArchive = new FrameArchive();
+    if (!m_frameArchive->create(QUrl::fromUserInput(archiveFile).toLocalFile(), m_size * m_dpr, m_startFrame + 1, m_endFrame - m_startFrame,
+            frameRate, FrameArchive::compression(m_outputFormat))) {
+        delete m_frameArchive;
+        m_frameArchive = nullptr;
+        return false;
+    }
+    m_frameEncoder->setArchive(m_frameArchive);
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "FrameEncoder.h"
+#include "FrameProfiler.h"
+#include "FrameScheduler.h"
+#include "QmlComponentCache.h"
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QSize>
+#include <QString>
+#include <QThread>
+#include <QVariantMap>
+#include <atomic>
+
+// Settings and output plumbing shared by the render jobs, independent of the
+// scene graph backend: the QML engine and scene, the frame range, the encoder
+// with its stream or archive, skipped frames and the hash index and profile
+// written at the end. The jobs add the window, render target and render loop.
+class RenderJobBase {
+public:
+    QSize m_size;
+    QString m_outputName;
+    QString m_outputFormat;
+    // png level and filter, jpg/webp quality, see ImageEncoder
+    ImageEncoder::Options m_imageOptions;
+    QString m_outputDirectory;
+    QString m_qmlFile;
+    // Set on the root object before its bindings are evaluated
+    QVariantMap m_initialProperties;
+    qreal m_dpr = 0;
+    qreal m_fps = 0;
+    int m_frames = 0;
+    int m_currentFrame = 0;
+    int m_duration = 0;
+    // Renders [m_startFrame, m_endFrame), m_endFrame < 0 renders until m_frames
+    int m_startFrame = 0;
+    int m_endFrame = -1;
+    int m_encoderThreads = QThread::idealThreadCount();
+    int m_encoderQueueDepth = 2 * QThread::idealThreadCount();
+    // Command whose stdin receives y4m frames when m_outputFormat is "pipe"
+    QString m_streamCommand;
+    bool m_yuvFullRange = false;
+    // Reuse the previous output while the scene graph reports no changes
+    bool m_skipUnchangedFrames = false;
+    // Link frames with identical pixels to the first one and write a <name>.xxh64 index
+    bool m_deduplicateFrames = false;
+    // Shared live counters, may be null
+    RenderMetrics* m_metrics = nullptr;
+
+public:
+    // Thread safe
+    void setPaused(bool paused) { m_scheduler.setPaused(paused); }
+    bool isPaused() const { return m_scheduler.isPaused(); }
+    void cancel() { m_scheduler.cancel(); }
+    bool isCancelled() const { return m_scheduler.isCancelled(); }
+    // Stage timings of the last render, when FrameProfiler is enabled.
+    const FrameProfiler& profiler() const { return m_profiler; }
+
+protected:
+    // The scheduler runs the frames on the owner's thread.
+    explicit RenderJobBase(QObject* owner);
+
+    // The engine incubates with the window's controller.
+    void createEngine(QQuickWindow* window);
+    // Deletes the scene, engine and encoder, called by the job's destructor after its window.
+    void destroyEngine();
+    // Replaces the scene of a reused job, false with the errors reported.
+    bool loadQml(QQuickWindow* window);
+    // Bounds m_startFrame and m_endFrame by the frames of m_duration.
+    void initFrameRange(const FrameRate& frameRate);
+    // Opens the stream or archive of m_outputFormat, false with a warning when that fails.
+    bool openOutput(const FrameRate& frameRate);
+    // Resets the encoder, profile and skipped frames for a new render.
+    void prepareRender();
+    // Waits for the encoder, writes the hash index and profile and closes the output.
+    void closeOutput(bool writeIndex = true);
+    // Hands one rendered image to the encoder for all of the given frames.
+    void enqueueFrames(const QImage& image, const QList<int>& frames);
+    // Percentage of the frame range
+    int rangePercent(int frames) const;
+    // m_outputName, plus the frame range for partial renders
+    QString rangeName() const;
+
+private:
+    QString outputFile(int frameNumber) const;
+    void writeHashIndex();
+    void writeProfile();
+    bool openStream(const FrameRate& frameRate);
+    bool openArchive(const FrameRate& frameRate);
+
+protected:
+    QQmlEngine* m_qmlEngine = nullptr;
+    QmlComponentCache* m_componentCache = nullptr;
+    // Owned by m_componentCache
+    QQmlComponent* m_qmlComponent = nullptr;
+    QQuickItem* m_rootItem = nullptr;
+    FrameEncoder* m_frameEncoder = nullptr;
+    FrameStream* m_frameStream = nullptr;
+    FrameArchive* m_frameArchive = nullptr;
+    FrameProfiler m_profiler;
+    // Lives on the owner thread like the job object itself
+    FrameScheduler m_scheduler;
+
+    std::atomic<bool> m_sceneDirty = true;
+    int m_lastRenderedFrame = -1;
+    int m_skippedFrames = 0;
+    // Rendered frame -> later frames that reuse its output
+    QHash<int, QList<int>> m_duplicateFrames;
+    QImage m_pendingImage;
+    int m_pendingFrame = -1;
+};
@@ -3,19 +3,31 @@
 
 #include "RenderJobOpenGl.h"
 
+#include <QDir>
+#include <QOpenGLExtraFunctions>
+#include <QUrl>
+#include <QtMath>
+#include <algorithm>
+
 RenderJobOpenGl::RenderJobOpenGl(QObject* parent)
     : QObject(parent)
+    , RenderJobBase(this)
 {
+    QObject::connect(&m_scheduler, &FrameScheduler::finished, this, [this](bool cancelled) {
+        if (cancelled)
+            qInfo() << "Cancelled" << m_outputName << "after" << m_currentFrame - m_startFrame << "frames";
+        cleanup();
+        emit finished();
+    });
 }
 
 RenderJobOpenGl::~RenderJobOpenGl()
 {
     m_context->makeCurrent(m_offscreenSurface);
     delete m_renderControl;
-    delete m_qmlComponent;
     delete m_quickWindow;
-    delete m_qmlEngine;
-    delete m_fbo;
+    destroyEngine();
+    destroyFbo();
 
     m_context->doneCurrent();
 
@@ -24,18 +36,56 @@ RenderJobOpenGl::~RenderJobOpenGl()
     delete m_animationDriver;
 }
 
+void RenderJobOpenGl::createOffscreenSurface()
+{
+    m_format.setDepthBufferSize(16);
+    m_format.setStencilBufferSize(8);
+    m_format.setVersion(3, 2); // Specify OpenGL version
+    m_format.setProfile(QSurfaceFormat::CoreProfile); // Specify profile
+
+    m_offscreenSurface = new QOffscreenSurface();
+    m_offscreenSurface->setFormat(m_format);
+    m_offscreenSurface->create();
+}
+
+int RenderJobOpenGl::maxFboSize()
+{
+    static const int maxSize = []() {
+        QOffscreenSurface surface;
+        surface.create();
+        QOpenGLContext context;
+        if (!context.create() || !context.makeCurrent(&surface))
+            return 0;
+        // Same limits as tileExtent()
+        GLint maxTextureSize = 0;
+        GLint maxRenderbufferSize = 0;
+        context.functions()->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+        context.functions()->glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+        context.doneCurrent();
+        return int(qMin(maxTextureSize, maxRenderbufferSize));
+    }();
+    return maxSize;
+}
+
 bool RenderJobOpenGl::init()
 {
+    // The backend is chosen once per process, see MovieRenderer::selectGraphicsApi().
+    if (QQuickWindow::graphicsApi() != QSGRendererInterface::OpenGL) {
+        qWarning("RenderJobOpenGl: The OpenGL backend was not selected, see MovieRenderer::selectGraphicsApi()");
+        return false;
+    }
+
+    if (!m_offscreenSurface)
+        createOffscreenSurface();
+
     m_context = new QOpenGLContext();
-    m_offscreenSurface = new QOffscreenSurface();
     m_renderControl = new QQuickRenderControl();
-
-    QSurfaceFormat format;
-    format.setDepthBufferSize(16);
-    format.setStencilBufferSize(8);
-    format.setVersion(3, 2); // Specify OpenGL version
-    format.setProfile(QSurfaceFormat::CoreProfile); // Specify profile
-    m_context->setFormat(format);
+    // Direct, the flag is read by the render loop.
+    QObject::connect(
+        m_renderControl, &QQuickRenderControl::sceneChanged, this, [this]() { m_sceneDirty = true; }, Qt::DirectConnection);
+    QObject::connect(
+        m_renderControl, &QQuickRenderControl::renderRequested, this, [this]() { m_sceneDirty = true; }, Qt::DirectConnection);
+    m_context->setFormat(m_format);
 
     if (!m_context->create()) {
         qFatal("Unable to init opengl context");
@@ -46,12 +96,8 @@ bool RenderJobOpenGl::init()
         return false;
     }
 
-    m_offscreenSurface->setFormat(m_context->format());
-    m_offscreenSurface->create();
-
     // Create and initialize quick window in the main thread
     m_quickWindow = new QQuickWindow(m_renderControl);
-    m_quickWindow->setGraphicsApi(QSGRendererInterface::OpenGL);
     if (!m_context->makeCurrent(m_offscreenSurface)) {
         qFatal("Unable to make context current on offscreen surface");
     }
@@ -60,64 +106,47 @@ bool RenderJobOpenGl::init()
         return false;
     }
 
-    // Create QML engine
-    m_qmlEngine = new QQmlEngine();
-    if (!m_qmlEngine->incubationController())
-        m_qmlEngine->setIncubationController(m_quickWindow->incubationController());
-}
-
-bool RenderJobOpenGl::loadQml()
-{
-    if (m_qmlComponent != nullptr)
-        delete m_qmlComponent;
-    m_qmlComponent = new QQmlComponent(m_qmlEngine, QUrl(QUrl::fromUserInput(m_qmlFile)),
-        QQmlComponent::PreferSynchronous);
-
-    if (m_qmlComponent->isError()) {
-        const QList<QQmlError> errorList = m_qmlComponent->errors();
-        for (const QQmlError& error : errorList)
-            qWarning() << error.url() << error.line() << error;
-        return false;
-    }
-
-    QObject* rootObject = m_qmlComponent->create();
-    if (m_qmlComponent->isError()) {
-        const QList<QQmlError> errorList = m_qmlComponent->errors();
-        for (const QQmlError& error : errorList)
-            qWarning() << error.url() << error.line() << error;
-        return false;
-    }
-
-    m_rootItem = qobject_cast<QQuickItem*>(rootObject);
-    if (!m_rootItem) {
-        qWarning("run: Not a QQuickItem");
-        delete rootObject;
-        return false;
-    }
+    createEngine(m_quickWindow);
+    // Direct, the job's own thread is busy rendering and would only deliver these at the end.
+    QObject::connect(
+        m_frameEncoder, &FrameEncoder::frameEncoded, this, [this](int encodedFrames) { emit fileProgressChanged(rangePercent(encodedFrames)); },
+        Qt::DirectConnection);
 
-    // The root item is ready. Associate it with the window.
-    m_rootItem->setParentItem(m_quickWindow->contentItem());
-
-    m_rootItem->setWidth(m_size.width());
-    m_rootItem->setHeight(m_size.height());
-
-    m_quickWindow->setGeometry(0, 0, m_size.width(), m_size.height());
     return true;
 }
 
 void RenderJobOpenGl::start()
 {
-    loadQml();
+    if (!loadQml(m_quickWindow)) {
+        qWarning() << "Unable to load" << m_qmlFile;
+        emit finished();
+        return;
+    }
     // emit statusChanged(Status::Running);
     createFbo();
 
     // Render each frame of movie
-    m_frames = m_duration / 1000 * m_fps;
-    m_animationDriver = new AnimationDriver(1000 / m_fps);
+    const FrameRate frameRate = FrameRate::fromFps(m_fps);
+    initFrameRange(frameRate);
+    if (!m_tileExtent.isEmpty()) {
+        if (!openTiledWriter(frameRate)) {
+            qWarning("Unable to open tiled output");
+            emit finished();
+            return;
+        }
+    } else if (!openOutput(frameRate)) {
+        emit finished();
+        return;
+    }
+    prepareRender();
+    openRenditions(frameRate);
+    m_animationDriver = new AnimationDriver(frameRate);
     m_animationDriver->install();
-    m_currentFrame = 0;
+    // Seek instead of stepping through the frames before the requested range.
+    m_animationDriver->seek(m_startFrame);
+    m_lastFrameBlurred = false;
     // Start the renderer
-    renderNext();
+    m_scheduler.start([this]() { return renderNext(); });
 }
 
 void RenderJobOpenGl::cleanup()
@@ -126,7 +155,25 @@ void RenderJobOpenGl::cleanup()
     delete m_animationDriver;
     m_animationDriver = nullptr;
 
-    destroyFbo();
+    // Collect the frames still in flight in the readback rings, the renditions
+    // first, the main output hands their frames to them.
+    for (RenditionOutput* rendition : std::as_const(m_renditionOutputs))
+        rendition->drain();
+    while (m_frameReadback && m_frameReadback->hasPending()) {
+        const FrameReadback::Frame frame = m_frameReadback->takeOldest();
+        saveImage(frame.image, frame.frameNumber);
+    }
+    flushPendingImage();
+
+    // Waits for their encoders, they share the profile written below.
+    qDeleteAll(m_renditionOutputs);
+    m_renditionOutputs.clear();
+    closeOutput(!m_tiledWriter);
+    delete m_tiledWriter;
+    m_tiledWriter = nullptr;
+    m_strip = QImage();
+    // The fbo is kept for the next job of the same size.
+    destroyReadback();
 }
 
 void RenderJobOpenGl::createFbo()
@@ -149,66 +196,445 @@ void RenderJobOpenGl::createFbo()
         return;
     }
 
-    m_fbo = new QOpenGLFramebufferObject(
-        m_size * m_dpr, QOpenGLFramebufferObject::CombinedDepthStencil);
+    destroyReadback();
+    const QSize frameSize = m_size * m_dpr;
+    m_tileExtent = tileExtent(frameSize);
+    int supersample = qMax(1, m_supersample);
+    if (supersample > 1 && !m_tileExtent.isEmpty()) {
+        qWarning("Supersampling is not available for tiled frames");
+        supersample = 1;
+    }
+    if (m_motionBlurSamples > 1 && !m_tileExtent.isEmpty())
+        qWarning("Motion blur is not available for tiled frames");
+    if (supersample > 1) {
+        GLint maxSize = 0;
+        ctx->functions()->glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+        while (supersample > 1 && qMax(frameSize.width(), frameSize.height()) * supersample > maxSize)
+            --supersample;
+        if (supersample != m_supersample)
+            qWarning() << "Supersampling reduced to" << supersample << "by the maximum fbo size" << maxSize;
+    }
+    const QSize fboSize = m_tileExtent.isEmpty() ? frameSize * supersample : m_tileExtent;
+    if (m_fbo && m_fbo->size() != fboSize) {
+        delete m_fbo;
+        m_fbo = nullptr;
+    }
+    if (!m_fbo) {
+        m_fbo = new QOpenGLFramebufferObject(
+            fboSize, QOpenGLFramebufferObject::CombinedDepthStencil);
+    }
 
     if (!m_fbo->isValid()) {
         qFatal("invalid m_fbo");
     }
 
+    // With MSAA Qt Quick renders into a multisample renderbuffer and resolves into the texture.
     QQuickRenderTarget renderTarget = QQuickRenderTarget::fromOpenGLTexture(
-        m_fbo->texture(), m_fbo->size());
+        m_fbo->texture(), m_fbo->size(), qMax(1, m_samples));
 
     if (renderTarget.isNull()) {
         qFatal("invalid renderTarget");
     }
+    // The scene keeps its logical size, supersampled frames have more pixels per item.
+    renderTarget.setDevicePixelRatio(m_dpr * supersample);
     m_quickWindow->setRenderTarget(renderTarget);
+
+    if (!m_tileExtent.isEmpty()) {
+        // The window only covers one tile, the root item keeps the frame size
+        // and is moved under it. Tiles are read back synchronously.
+        m_quickWindow->setGeometry(0, 0, qCeil(fboSize.width() / m_dpr), qCeil(fboSize.height() / m_dpr));
+        return;
+    }
+
+    // Readback and encoding stay at the output size.
+    if (supersample > 1) {
+        m_downsampler = new GpuDownsampler();
+        if (!m_downsampler->create(m_fbo->size(), frameSize)) {
+            qFatal("Unable to create the supersampling fbos");
+            return;
+        }
+    }
+
+    if (m_motionBlurSamples > 1) {
+        m_accumulator = new GpuFrameAccumulator();
+        if (!m_accumulator->create(frameSize)) {
+            qWarning("Rendering without motion blur");
+            delete m_accumulator;
+            m_accumulator = nullptr;
+        }
+    }
+
+    if (m_gpuYuv && (m_outputFormat == "y4m" || m_outputFormat == "pipe")) {
+        m_yuvConverter = new GpuYuvConverter();
+        if (!m_yuvConverter->create(frameSize, m_yuvFullRange)) {
+            qWarning("Falling back to yuv conversion on the CPU");
+            delete m_yuvConverter;
+            m_yuvConverter = nullptr;
+        }
+    }
+
+    if (m_asyncReadback) {
+        m_frameReadback = new FrameReadback(m_readbackBufferCount);
+        const bool created = m_yuvConverter
+            ? m_frameReadback->create(m_yuvConverter->outputSize(), QImage::Format_Grayscale8)
+            : m_frameReadback->create(frameSize);
+        m_frameReadback->setOutputFormat(FrameEncoder::preferredImageFormat(m_outputFormat));
+        m_frameReadback->setProfiler(&m_profiler);
+        if (!created) {
+            qWarning("Falling back to synchronous readback");
+            delete m_frameReadback;
+            m_frameReadback = nullptr;
+        }
+    }
+}
+
+QSize RenderJobOpenGl::tileExtent(const QSize& frameSize) const
+{
+    QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
+    GLint maxTextureSize = 0;
+    GLint maxRenderbufferSize = 0;
+    f->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    f->glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+    const int maxSize = qMin(maxTextureSize, maxRenderbufferSize);
+
+    int tileSize = m_tileSize;
+    if (tileSize <= 0) {
+        if (frameSize.width() <= maxSize && frameSize.height() <= maxSize)
+            return QSize();
+        tileSize = qMin(maxSize, 4096);
+    }
+    // Even, so every strip but the last covers whole chroma rows of y4m output.
+    tileSize = qMax(2, qMin(tileSize, maxSize) & ~1);
+    return QSize(qMin(tileSize, frameSize.width()), qMin(tileSize, frameSize.height()));
+}
+
+bool RenderJobOpenGl::openTiledWriter(const FrameRate& frameRate)
+{
+    m_tiledFormat = m_outputFormat;
+    if (!TiledFrameWriter::isSupportedFormat(m_tiledFormat)) {
+        qWarning() << "Tiled frames are written as pam, ppm, rgba or y4m, writing pam instead of" << m_outputFormat;
+        m_tiledFormat = "pam";
+    }
+    if (m_skipUnchangedFrames || m_deduplicateFrames)
+        qWarning("Tiled frames are neither skipped nor deduplicated");
+
+    const QSize frameSize = m_size * m_dpr;
+    const QString streamFile(m_outputDirectory + QDir::separator() + m_outputName + "." + m_tiledFormat);
+    m_tiledWriter = new TiledFrameWriter();
+    if (!m_tiledWriter->open(m_tiledFormat, QUrl::fromUserInput(streamFile).toLocalFile(), frameSize, frameRate, m_yuvFullRange)) {
+        delete m_tiledWriter;
+        m_tiledWriter = nullptr;
+        return false;
+    }
+    m_strip = QImage(frameSize.width(), m_tileExtent.height(), QImage::Format_RGBA8888_Premultiplied);
+    qInfo().noquote() << QString("Rendering %1x%2 in %3x%4 tiles")
+                             .arg(frameSize.width())
+                             .arg(frameSize.height())
+                             .arg(m_tileExtent.width())
+                             .arg(m_tileExtent.height());
+    return true;
+}
+
+void RenderJobOpenGl::destroyReadback()
+{
+    delete m_frameReadback;
+    m_frameReadback = nullptr;
+    delete m_yuvConverter;
+    m_yuvConverter = nullptr;
+    delete m_downsampler;
+    m_downsampler = nullptr;
+    delete m_accumulator;
+    m_accumulator = nullptr;
 }
 
 void RenderJobOpenGl::destroyFbo()
 {
+    destroyReadback();
     delete m_fbo;
     m_fbo = nullptr;
 }
 
-void RenderJobOpenGl::saveImage(const QImage& image, const QString& outputFile)
+void RenderJobOpenGl::saveImage(const QImage& image, int frameNumber)
+{
+    if (!m_skipUnchangedFrames) {
+        enqueueFrames(image, { frameNumber });
+        saveRenditions(frameNumber, { frameNumber });
+        return;
+    }
+
+    // Hold the frame back until the frames reusing it are known, the readback
+    // ring hands it over after those were skipped.
+    flushPendingImage();
+    m_pendingImage = image;
+    m_pendingFrame = frameNumber;
+}
+
+void RenderJobOpenGl::flushPendingImage()
 {
-    const auto a = QUrl::fromUserInput(outputFile).toLocalFile();
-    qInfo() << "Save:" << image.save(a);
+    if (m_pendingFrame < 0)
+        return;
+
+    const QList<int> frames = QList<int> { m_pendingFrame } + m_duplicateFrames.take(m_pendingFrame);
+    enqueueFrames(m_pendingImage, frames);
+    saveRenditions(m_pendingFrame, frames);
+
+    m_pendingImage = QImage();
+    m_pendingFrame = -1;
 }
 
-void RenderJobOpenGl::renderNext()
+void RenderJobOpenGl::openRenditions(const FrameRate& frameRate)
 {
-    if (!m_context->makeCurrent(m_offscreenSurface)) {
-        qFatal("Unable to make context current on offscreen surface");
+    if (m_renditions.isEmpty())
+        return;
+    if (m_tiledWriter) {
+        qWarning("Renditions are not available for tiled frames");
         return;
     }
 
-    //  Polish, synchronize and render the next frame (into our fbo).
-    m_renderControl->polishItems();
-    m_renderControl->beginFrame();
-    // If a dedicated render thread is used, the GUI thread should be blocked for the duration of this call.
+    const QSize frameSize = m_size * m_dpr;
+    for (const QString& rendition : m_renditions) {
+        QSize size;
+        QString format;
+        if (!RenditionOutput::parse(rendition, m_outputFormat, &size, &format)) {
+            qWarning() << "Invalid rendition" << rendition << "expected <width>x<height>[:<format>]";
+            continue;
+        }
+        if (size.width() > frameSize.width() || size.height() > frameSize.height()) {
+            qWarning() << "Rendition" << rendition << "is larger than the rendered frame" << frameSize;
+            continue;
+        }
+        // Without a format of their own renditions share the job's image options.
+        ImageEncoder::Options imageOptions = m_imageOptions;
+        if (format != m_outputFormat)
+            ImageEncoder::parseFormat(format, &format, &imageOptions);
+        m_renditionOutputs.append(new RenditionOutput(size, format, imageOptions));
+    }
+    // Largest first, so that each is scaled from the previous one when it fits.
+    std::sort(m_renditionOutputs.begin(), m_renditionOutputs.end(), [](RenditionOutput* a, RenditionOutput* b) {
+        return qint64(a->frameSize().width()) * a->frameSize().height() > qint64(b->frameSize().width()) * b->frameSize().height();
+    });
+
+    QSize sourceSize = frameSize;
+    for (qsizetype i = 0; i < m_renditionOutputs.size();) {
+        RenditionOutput* rendition = m_renditionOutputs[i];
+        if (rendition->frameSize().width() > sourceSize.width() || rendition->frameSize().height() > sourceSize.height())
+            sourceSize = frameSize;
+        rendition->encoder()->setWorkerCount(m_encoderThreads);
+        rendition->encoder()->setMaxQueueDepth(m_encoderQueueDepth);
+        rendition->encoder()->setProfiler(&m_profiler);
+        if (!rendition->open(sourceSize, m_outputDirectory, m_outputName, frameRate, m_yuvFullRange, m_frameReadback ? m_readbackBufferCount : 0)) {
+            qWarning() << "Unable to open rendition" << rendition->frameSize();
+            delete m_renditionOutputs.takeAt(i);
+            continue;
+        }
+        sourceSize = rendition->frameSize();
+        ++i;
+    }
+}
+
+void RenderJobOpenGl::readRenditions(QOpenGLFramebufferObject* frameFbo)
+{
+    // Same source choice as openRenditions().
+    QOpenGLFramebufferObject* source = frameFbo;
+    for (RenditionOutput* rendition : std::as_const(m_renditionOutputs)) {
+        if (rendition->frameSize().width() > source->width() || rendition->frameSize().height() > source->height())
+            source = frameFbo;
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Downsample, m_currentFrame);
+        source = rendition->read(source, m_currentFrame);
+    }
+}
 
-    m_renderControl->sync();
-    m_renderControl->render();
-    m_renderControl->endFrame();
-    m_context->functions()->glFlush();
+void RenderJobOpenGl::saveRenditions(int frameNumber, const QList<int>& frames)
+{
+    for (RenditionOutput* rendition : std::as_const(m_renditionOutputs))
+        rendition->save(frameNumber, frames);
+}
 
+bool RenderJobOpenGl::renderNext()
+{
     m_currentFrame++;
 
-    QString outputFile(m_outputDirectory + QDir::separator() + m_outputName + "_" + QString::number(m_currentFrame) + "." + m_outputFormat);
-    const auto imageFrameUrl = QUrl::fromUserInput(outputFile).toLocalFile();
-    auto image = m_fbo->toImage();
-    qInfo() << "Save:" << image.save(imageFrameUrl) << "to:" << imageFrameUrl;
+    // Nothing changed since the last sync, reuse the previous output. A motion
+    // blurred frame that still moved within its interval differs from a still one.
+    if (m_skipUnchangedFrames && !m_tiledWriter && !m_sceneDirty && !m_lastFrameBlurred && m_lastRenderedFrame >= 0) {
+        m_duplicateFrames[m_lastRenderedFrame].append(m_currentFrame);
+        emit skippedFramesChanged(++m_skippedFrames);
+    } else {
+        renderFrame();
+    }
 
     // advance animation
     m_animationDriver->advance();
-    emit progressChanged((m_currentFrame / m_frames) * 100);
+    if (m_metrics)
+        RenderMetrics::add(m_metrics->renderedFrames, 1);
+    emit progressChanged(rangePercent(m_currentFrame - m_startFrame));
+
+    return m_currentFrame < m_endFrame;
+}
+
+void RenderJobOpenGl::renderFrame()
+{
+    if (!m_context->makeCurrent(m_offscreenSurface)) {
+        qFatal("Unable to make context current on offscreen surface");
+        return;
+    }
+    if (m_tiledWriter) {
+        renderTiledFrame();
+        return;
+    }
 
-    if (m_currentFrame < m_frames) {
-        renderNext();
+    QOpenGLFramebufferObject* outputFbo = nullptr;
+    if (m_accumulator) {
+        // The sub-frames cover the whole frame interval, like a 360 degree shutter.
+        m_accumulator->clear();
+        bool moving = false;
+        for (int subFrame = 0; subFrame < m_motionBlurSamples; ++subFrame) {
+            if (subFrame > 0) {
+                m_animationDriver->seekSubFrame(subFrame, m_motionBlurSamples);
+                moving = moving || m_sceneDirty;
+            }
+            QOpenGLFramebufferObject* subFrameFbo = renderScene();
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Accumulate, m_currentFrame);
+            m_accumulator->accumulate(subFrameFbo->texture(), 1.0f / m_motionBlurSamples);
+        }
+        {
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Accumulate, m_currentFrame);
+            outputFbo = m_accumulator->resolve();
+        }
+        m_lastFrameBlurred = moving;
     } else {
-        // Finished
-        cleanup();
+        outputFbo = renderScene();
+    }
+
+    // Before the main readback ring hands out a frame that needs their copies.
+    readRenditions(outputFbo);
+
+    QOpenGLFramebufferObject* readbackFbo = outputFbo;
+    if (m_yuvConverter) {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::YuvConversion, m_currentFrame);
+        readbackFbo = m_yuvConverter->convert(outputFbo->texture());
+    }
+    if (m_frameReadback) {
+        // Only map the oldest buffer once the ring is full, the newer reads keep running on the GPU.
+        if (m_frameReadback->isFull()) {
+            const FrameReadback::Frame frame = m_frameReadback->takeOldest();
+            saveImage(frame.image, frame.frameNumber);
+        }
+        m_frameReadback->read(readbackFbo, m_currentFrame);
+    } else {
+        QImage image;
+        {
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Readback, m_currentFrame);
+            image = m_yuvConverter ? m_yuvConverter->toImage() : FrameReadback::readImage(outputFbo, FrameEncoder::preferredImageFormat(m_outputFormat));
+        }
+        saveImage(image, m_currentFrame);
+    }
+    m_lastRenderedFrame = m_currentFrame;
+}
+
+QOpenGLFramebufferObject* RenderJobOpenGl::renderScene()
+{
+    //  Polish, synchronize and render the next frame (into our fbo).
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Polish, m_currentFrame);
+        m_renderControl->polishItems();
+    }
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::BeginFrame, m_currentFrame);
+        m_renderControl->beginFrame();
+    }
+    // If a dedicated render thread is used, the GUI thread should be blocked for the duration of this call.
+
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Sync, m_currentFrame);
+        m_renderControl->sync();
+    }
+    // Changes from here on belong to the next frame.
+    m_sceneDirty = false;
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Render, m_currentFrame);
+        m_renderControl->render();
+    }
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::EndFrame, m_currentFrame);
+        m_renderControl->endFrame();
+        m_context->functions()->glFlush();
+    }
+
+    if (!m_downsampler)
+        return m_fbo;
+    FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Downsample, m_currentFrame);
+    return m_downsampler->downsample(m_fbo);
+}
+
+void RenderJobOpenGl::renderTiledFrame()
+{
+    const QSize frameSize = m_size * m_dpr;
+    const QSize tileSize = m_fbo->size();
+    QOpenGLExtraFunctions* f = m_context->extraFunctions();
+    const qint64 bytesWritten = m_tiledWriter->bytesWritten();
+
+    const QString fileName = TiledFrameWriter::isStreamFormat(m_tiledFormat)
+        ? QString()
+        : QUrl::fromUserInput(m_outputDirectory + QDir::separator() + m_outputName + "_" + QString::number(m_currentFrame) + "." + m_tiledFormat).toLocalFile();
+    bool written = m_tiledWriter->beginFrame(fileName);
+
+    // The animation only advances after the last tile, every tile shows the same frame.
+    for (int top = 0; top < frameSize.height() && written; top += tileSize.height()) {
+        const int rows = qMin(tileSize.height(), frameSize.height() - top);
+        for (int left = 0; left < frameSize.width(); left += tileSize.width()) {
+            const int columns = qMin(tileSize.width(), frameSize.width() - left);
+            // Move the scene so that this tile lands in the fbo.
+            m_rootItem->setPosition(QPointF(-left / m_dpr, -top / m_dpr));
+            {
+                FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Polish, m_currentFrame);
+                m_renderControl->polishItems();
+            }
+            {
+                FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::BeginFrame, m_currentFrame);
+                m_renderControl->beginFrame();
+            }
+            {
+                FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Sync, m_currentFrame);
+                m_renderControl->sync();
+            }
+            {
+                FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Render, m_currentFrame);
+                m_renderControl->render();
+            }
+            {
+                FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::EndFrame, m_currentFrame);
+                m_renderControl->endFrame();
+            }
+            // GL rows are bottom up, the top rows of the tile are the last rows
+            // of the fbo. They are read straight into their columns of the strip
+            // and the whole strip is flipped once the row of tiles is complete.
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Readback, m_currentFrame);
+            m_fbo->bind();
+            f->glPixelStorei(GL_PACK_ROW_LENGTH, frameSize.width());
+            f->glReadPixels(0, tileSize.height() - rows, columns, rows, GL_RGBA, GL_UNSIGNED_BYTE, m_strip.bits() + qsizetype(left) * 4);
+            f->glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+            QOpenGLFramebufferObject::bindDefault();
+        }
+
+        {
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Conversion, m_currentFrame);
+            for (int y = 0; y < rows / 2; ++y)
+                std::swap_ranges(m_strip.scanLine(y), m_strip.scanLine(y) + m_strip.bytesPerLine(), m_strip.scanLine(rows - 1 - y));
+        }
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Write, m_currentFrame);
+        written = m_tiledWriter->writeStrip(QImage(m_strip.constBits(), frameSize.width(), rows, m_strip.bytesPerLine(), QImage::Format_RGBA8888_Premultiplied));
+    }
+    written = m_tiledWriter->endFrame() && written;
+    if (!written)
+        qWarning() << "Unable to write frame" << m_currentFrame;
+
+    // Written synchronously, the frame is done as far as the metrics are concerned.
+    if (m_metrics) {
+        RenderMetrics::add(m_metrics->encodedFrames, 1);
+        RenderMetrics::add(m_metrics->bytesWritten, m_tiledWriter->bytesWritten() - bytesWritten);
     }
+    emit fileProgressChanged(rangePercent(m_currentFrame - m_startFrame));
+    m_sceneDirty = false;
+    m_lastRenderedFrame = m_currentFrame;
 }
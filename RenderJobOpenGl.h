@@ -1,8 +1,14 @@
 #pragma once
 
+#include "FrameReadback.h"
+#include "GpuDownsampler.h"
+#include "GpuFrameAccumulator.h"
+#include "GpuYuvConverter.h"
+#include "RenderJobBase.h"
+#include "RenditionOutput.h"
+#include "TiledFrameWriter.h"
 #include "animationdriver.h"
 #include <QCoreApplication>
-#include <QDir>
 #include <QEvent>
 #include <QFuture>
 #include <QObject>
@@ -13,54 +19,90 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLVertexArrayObject>
-#include <QQmlComponent>
-#include <QQmlEngine>
 #include <QQuickGraphicsDevice>
-#include <QQuickItem>
 #include <QQuickRenderControl>
 #include <QQuickRenderTarget>
 #include <QQuickWindow>
 #include <QScreen>
 #include <QSize>
 #include <QString>
+#include <QStringList>
 #include <QThread>
 #include <QTimer>
 #include <QVector>
-#include <QtConcurrent>
 #include <memory>
 
-class RenderJobOpenGl : public QObject {
+class RenderJobOpenGl : public QObject, public RenderJobBase {
     Q_OBJECT
 public:
     explicit RenderJobOpenGl(QObject* parent = 0);
     ~RenderJobOpenGl();
-    QSize m_size;
-    QString m_outputName;
-    QString m_outputFormat;
-    QString m_outputDirectory;
-    QString m_qmlFile;
-    qreal m_dpr = 0;
-    int m_fps = 0;
-    int m_frames = 0;
-    int m_currentFrame = 0;
-    int m_duration = 0;
+    // Read frames back through a ring of pixel buffer objects instead of QOpenGLFramebufferObject::toImage()
+    bool m_asyncReadback = true;
+    int m_readbackBufferCount = 2;
+    // Convert to yuv420p on the GPU before readback for y4m/pipe output
+    bool m_gpuYuv = false;
+    // Renders every frame in tiles of this many device pixels and writes it
+    // strip by strip through TiledFrameWriter. 0 only tiles frames that exceed
+    // the maximum fbo size.
+    int m_tileSize = 0;
+    // Antialiasing. MSAA sample count of the render target, 0 or 1 is off.
+    int m_samples = 0;
+    // Renders at this multiple of the output size and downsamples on the GPU
+    // before readback, so readback and encoding cost stays the same.
+    int m_supersample = 1;
+    // Motion blur. Renders this many sub-frames spread over each frame interval
+    // and averages them on the GPU, only the average is read back. 1 is off.
+    int m_motionBlurSamples = 1;
+    // More outputs scaled down on the GPU from each rendered frame, as
+    // "<width>x<height>[:<format>]" in pixels, see RenditionOutput.
+    QStringList m_renditions;
     QThread* renderThread = nullptr;
 
 public:
+    // Only needed when the job runs on another thread, the surface has to be created on the gui thread.
+    void createOffscreenSurface();
+    // Largest fbo edge in device pixels, larger frames are tiled. Queried once
+    // on the gui thread with a throwaway context, 0 when there is none.
+    static int maxFboSize();
     bool init();
+    bool isInitialized() const { return m_renderControl; }
+    // Returns right away, the frames are rendered by the event loop of the
+    // job's thread until finished(). Can be called again after that, the
+    // context, engine and fbo (for the same size) are reused.
     void start();
-    void renderNext();
+    // Between start() and finished()
+    bool isRunning() const { return m_scheduler.isRunning(); }
+    // Blocks until finished(), for callers on the job's thread.
+    void waitForFinished() { m_scheduler.waitForFinished(); }
 
 signals:
     // void statusChanged(Status status);
     void progressChanged(int progress);
+    void fileProgressChanged(int fileProgress);
+    void skippedFramesChanged(int skippedFrames);
+    // Also emitted when cancelled or when the job could not start
+    void finished();
 
 private:
-    bool loadQml();
+    // One frame, false after the last one
+    bool renderNext();
     void cleanup();
     void createFbo();
     void destroyFbo();
-    void saveImage(const QImage& image, const QString& outputFile);
+    void destroyReadback();
+    void renderFrame();
+    // Renders the scene at the current animation time, returns the output sized fbo.
+    QOpenGLFramebufferObject* renderScene();
+    // Empty when the frame fits into one fbo and m_tileSize is 0
+    QSize tileExtent(const QSize& frameSize) const;
+    bool openTiledWriter(const FrameRate& frameRate);
+    void renderTiledFrame();
+    void openRenditions(const FrameRate& frameRate);
+    void readRenditions(QOpenGLFramebufferObject* frameFbo);
+    void saveRenditions(int frameNumber, const QList<int>& frames);
+    void saveImage(const QImage& image, int frameNumber);
+    void flushPendingImage();
 
 private:
     // Must be created from main (gui) thread
@@ -71,8 +113,24 @@ private:
     QOpenGLContext* m_context = nullptr;
     QOffscreenSurface* m_offscreenSurface = nullptr;
 
-    QQmlEngine* m_qmlEngine = nullptr;
-    QQmlComponent* m_qmlComponent = nullptr;
-    QQuickItem* m_rootItem = nullptr;
     AnimationDriver* m_animationDriver = nullptr;
+    QSurfaceFormat m_format;
+    FrameReadback* m_frameReadback = nullptr;
+    GpuYuvConverter* m_yuvConverter = nullptr;
+    // Only while supersampling, m_fbo then holds the oversized frame
+    GpuDownsampler* m_downsampler = nullptr;
+    // Only with motion blur
+    GpuFrameAccumulator* m_accumulator = nullptr;
+    // Tiled rendering, m_fbo then holds one tile
+    QSize m_tileExtent;
+    TiledFrameWriter* m_tiledWriter = nullptr;
+    QString m_tiledFormat;
+    // One row of tiles, as wide as the frame. The row-major output formats need
+    // whole rows, so tiled memory is bounded by one row of tiles (frame width
+    // times tile height), not by a single tile.
+    QImage m_strip;
+    QList<RenditionOutput*> m_renditionOutputs;
+
+    // The scene moved between the sub-frames of the last motion blurred frame
+    bool m_lastFrameBlurred = false;
 };
\ No newline at end of file
@@ -3,13 +3,26 @@
 
 #include "RenderJobOpenGlThreaded.h"
 
+RenderJobOpenGlThreaded::RenderJobOpenGlThreaded(QObject* parent)
+    : QThread(parent)
+    , RenderJobBase(this)
+{
+}
+
 RenderJobOpenGlThreaded::~RenderJobOpenGlThreaded()
 {
+    // Only finishRendering() lets the render thread leave its loop, the
+    // scheduler that would call it dies with the job. run() still drains
+    // the readback and closes the output.
+    if (isRunning()) {
+        m_scheduler.cancel();
+        finishRendering();
+    }
+    wait();
     m_context->makeCurrent(m_offscreenSurface);
     delete m_renderControl;
-    delete m_qmlComponent;
     delete m_quickWindow;
-    delete m_qmlEngine;
+    destroyEngine();
     delete m_fbo;
 
     m_context->doneCurrent();
@@ -21,15 +34,20 @@ RenderJobOpenGlThreaded::~RenderJobOpenGlThreaded()
 
 bool RenderJobOpenGlThreaded::initRendering()
 {
+    // The backend is chosen once per process, see MovieRenderer::selectGraphicsApi().
+    if (QQuickWindow::graphicsApi() != QSGRendererInterface::OpenGL) {
+        qWarning("RenderJobOpenGlThreaded: The OpenGL backend was not selected, see MovieRenderer::selectGraphicsApi()");
+        return false;
+    }
 
     // Create and initialize quick window in the main thread
     m_renderControl = new QQuickRenderControl();
+    // Direct, the flag is read by the render loop.
+    QObject::connect(
+        m_renderControl, &QQuickRenderControl::sceneChanged, this, [this]() { m_sceneDirty = true; }, Qt::DirectConnection);
+    QObject::connect(
+        m_renderControl, &QQuickRenderControl::renderRequested, this, [this]() { m_sceneDirty = true; }, Qt::DirectConnection);
     m_quickWindow = new QQuickWindow(m_renderControl);
-    m_quickWindow->setGraphicsApi(QSGRendererInterface::OpenGL);
-    if (!m_renderControl->initialize()) {
-        qFatal("Unable to initialize QQuickRenderControl");
-        return false;
-    }
 
     m_format.setDepthBufferSize(16);
     m_format.setStencilBufferSize(8);
@@ -39,199 +57,343 @@ bool RenderJobOpenGlThreaded::initRendering()
     m_offscreenSurface->setFormat(m_format);
     m_offscreenSurface->create();
 
-    // Create QML engine
-    m_qmlEngine = new QQmlEngine();
-    if (!m_qmlEngine->incubationController())
-        m_qmlEngine->setIncubationController(m_quickWindow->incubationController());
-
-    loadQml();
-
-    return true;
-}
-
-bool RenderJobOpenGlThreaded::loadQml()
-{
-    if (m_qmlComponent != nullptr)
-        delete m_qmlComponent;
-    m_qmlComponent = new QQmlComponent(m_qmlEngine, QUrl(QUrl::fromUserInput(m_qmlFile)),
-        QQmlComponent::PreferSynchronous);
-
-    if (m_qmlComponent->isError()) {
-        const QList<QQmlError> errorList = m_qmlComponent->errors();
-        for (const QQmlError& error : errorList)
-            qWarning() << error.url() << error.line() << error;
-        return false;
-    }
-
-    QObject* rootObject = m_qmlComponent->create();
-    if (m_qmlComponent->isError()) {
-        const QList<QQmlError> errorList = m_qmlComponent->errors();
-        for (const QQmlError& error : errorList)
-            qWarning() << error.url() << error.line() << error;
-        return false;
-    }
-
-    m_rootItem = qobject_cast<QQuickItem*>(rootObject);
-    if (!m_rootItem) {
-        qWarning("run: Not a QQuickItem");
-        delete rootObject;
+    m_context = new QOpenGLContext();
+    m_context->setFormat(m_format);
+    if (!m_context->create()) {
+        qFatal("Unable to init opengl context");
         return false;
     }
+    // The scene graph renders with our context, initialize() follows on the render thread.
+    m_quickWindow->setGraphicsDevice(QQuickGraphicsDevice::fromOpenGLContext(m_context));
+    m_renderControl->prepareThread(this);
 
-    // The root item is ready. Associate it with the window.
-    m_rootItem->setParentItem(m_quickWindow->contentItem());
-    m_rootItem->setWidth(m_size.width());
-    m_rootItem->setHeight(m_size.height());
+    createEngine(m_quickWindow);
+    // Direct, emitted from the encoder pool.
+    QObject::connect(
+        m_frameEncoder, &FrameEncoder::frameEncoded, this, [this](int encodedFrames) { emit fileProgressChanged(rangePercent(encodedFrames)); },
+        Qt::DirectConnection);
 
-    m_quickWindow->setGeometry(0, 0, m_size.width(), m_size.height());
     return true;
 }
 
 void RenderJobOpenGlThreaded::startRendering()
 {
-    m_context = new QOpenGLContext();
-    m_context->setFormat(m_format);
+    if (!loadQml(m_quickWindow)) {
+        qWarning() << "Unable to load" << m_qmlFile;
+        failRendering();
+        return;
+    }
 
-    if (!m_context->create()) {
-        qFatal("Unable to init opengl context");
+    const FrameRate frameRate = FrameRate::fromFps(m_fps);
+    initFrameRange(frameRate);
+    if (!openOutput(frameRate)) {
+        failRendering();
+        return;
+    }
+    prepareRender();
+    m_outputOpen = true;
+
+    // The render target is set before the render thread exists, the window is
+    // only polished and animated here while that thread renders.
+    if (!m_context->makeCurrent(m_offscreenSurface)) {
+        qFatal("Unable to make context current on offscreen surface");
         return;
     }
-    if (!m_context->isValid()) {
-        qFatal("Not isValid opengl context");
+    const bool fboCreated = initFbo();
+    m_context->doneCurrent();
+    if (!fboCreated) {
+        // The render thread closes the output that is already open.
+        failRendering();
         return;
     }
 
-    auto* thread = this->thread();
-    // Prepare and move the render control to the target thread
-    m_renderControl->prepareThread(thread);
-    // m_quickWindow->moveToThread(thread);
-    m_offscreenSurface->moveToThread(thread);
-    m_context->moveToThread(thread);
-    initFbo();
+    // Animations belong to the owner thread, so the driver is installed here.
+    m_animationDriver = new AnimationDriver(frameRate);
+    m_animationDriver->install();
+    // Seek instead of stepping through the frames before the requested range.
+    m_animationDriver->seek(m_startFrame);
+    m_requestedFrame = m_startFrame;
+    m_syncedFrame = m_startFrame;
+    m_stopRequested = false;
+
+    m_context->moveToThread(this);
+    start();
+    // The owner's event loop keeps running between frames.
+    QObject::connect(&m_scheduler, &FrameScheduler::finished, this, &RenderJobOpenGlThreaded::finishRendering, Qt::SingleShotConnection);
+    m_scheduler.start([this]() { return renderNext(); });
+}
 
-    // if (QThread::currentThread() != this->thread()) {
-    //     qFatal("We are not in the right thread");
-    //     // return;
-    // }
+void RenderJobOpenGlThreaded::failRendering()
+{
+    // The render thread still starts and stops right away, so finished() is emitted.
+    m_requestedFrame = m_syncedFrame;
+    m_stopRequested = true;
+    m_context->moveToThread(this);
+    start();
+}
 
-    // emit statusChanged(Status::Running);
+void RenderJobOpenGlThreaded::finishRendering()
+{
+    // Also called by the destructor, after the scheduler may have finished.
+    if (m_animationDriver) {
+        m_animationDriver->uninstall();
+        delete m_animationDriver;
+        m_animationDriver = nullptr;
+    }
 
-    // Render each frame of movie
-    m_frames = m_duration / 1000 * m_fps;
-    m_animationDriver = new AnimationDriver(1000 / m_fps);
-    m_animationDriver->install();
-    m_currentFrame = 0;
-    // Start the renderer
-    renderNext();
+    // The render thread drains the outstanding frames and finishes.
+    QMutexLocker lock(&m_mutex);
+    m_stopRequested = true;
+    m_requestCond.wakeOne();
 }
 
 void RenderJobOpenGlThreaded::cleanup()
 {
-    m_animationDriver->uninstall();
-    delete m_animationDriver;
-    m_animationDriver = nullptr;
-
+    // Collect the frames still in flight in the readback ring.
+    while (m_frameReadback && m_frameReadback->hasPending()) {
+        const FrameReadback::Frame frame = m_frameReadback->takeOldest();
+        saveImage(frame.image, frame.frameNumber);
+    }
+    flushPendingImage();
+    closeOutput();
+    m_outputOpen = false;
     destroyFbo();
 }
 
-void RenderJobOpenGlThreaded::initFbo()
+bool RenderJobOpenGlThreaded::initFbo()
 {
 
     if (m_size.isNull() || m_dpr <= 0) {
         qFatal("Invalid size or device pixel ratio");
     }
 
-    if (!m_context->makeCurrent(m_offscreenSurface)) {
-        qFatal("Unable to make context current on offscreen surface");
-        return;
-    }
-
     QOpenGLContext* ctx = QOpenGLContext::currentContext();
 
     if (!ctx) {
         qFatal("No context");
-        return;
+        return false;
     }
 
+    const QSize frameSize = m_size * m_dpr;
+    int supersample = qMax(1, m_supersample);
+    if (supersample > 1) {
+        GLint maxSize = 0;
+        ctx->functions()->glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+        while (supersample > 1 && qMax(frameSize.width(), frameSize.height()) * supersample > maxSize)
+            --supersample;
+        if (supersample != m_supersample)
+            qWarning() << "Supersampling reduced to" << supersample << "by the maximum fbo size" << maxSize;
+    }
     m_fbo = new QOpenGLFramebufferObject(
-        m_size * m_dpr, QOpenGLFramebufferObject::CombinedDepthStencil);
+        frameSize * supersample, QOpenGLFramebufferObject::CombinedDepthStencil);
 
+    // MovieRenderer routes frames beyond the maximum fbo size to RenderJobOpenGl, which tiles them.
     if (!m_fbo->isValid()) {
-        qFatal("invalid m_fbo");
+        qWarning() << "Unable to create a" << m_fbo->size() << "fbo";
+        delete m_fbo;
+        m_fbo = nullptr;
+        return false;
     }
 
+    // With MSAA Qt Quick renders into a multisample renderbuffer and resolves into the texture.
     QQuickRenderTarget renderTarget = QQuickRenderTarget::fromOpenGLTexture(
-        m_fbo->texture(), m_fbo->size());
+        m_fbo->texture(), m_fbo->size(), qMax(1, m_samples));
 
     if (renderTarget.isNull()) {
         qFatal("invalid renderTarget");
     }
+    renderTarget.setDevicePixelRatio(m_dpr * supersample);
     m_quickWindow->setRenderTarget(renderTarget);
+
+    // Readback and encoding stay at the output size.
+    if (supersample > 1) {
+        m_downsampler = new GpuDownsampler();
+        if (!m_downsampler->create(m_fbo->size(), frameSize)) {
+            qFatal("Unable to create the supersampling fbos");
+            return false;
+        }
+    }
+
+    if (m_gpuYuv && (m_outputFormat == "y4m" || m_outputFormat == "pipe")) {
+        m_yuvConverter = new GpuYuvConverter();
+        if (!m_yuvConverter->create(frameSize, m_yuvFullRange)) {
+            qWarning("Falling back to yuv conversion on the CPU");
+            delete m_yuvConverter;
+            m_yuvConverter = nullptr;
+        }
+    }
+
+    if (m_asyncReadback) {
+        m_frameReadback = new FrameReadback(m_readbackBufferCount);
+        const bool created = m_yuvConverter
+            ? m_frameReadback->create(m_yuvConverter->outputSize(), QImage::Format_Grayscale8)
+            : m_frameReadback->create(frameSize);
+        m_frameReadback->setOutputFormat(FrameEncoder::preferredImageFormat(m_outputFormat));
+        m_frameReadback->setProfiler(&m_profiler);
+        if (!created) {
+            qWarning("Falling back to synchronous readback");
+            delete m_frameReadback;
+            m_frameReadback = nullptr;
+        }
+    }
+    return true;
 }
 
 void RenderJobOpenGlThreaded::destroyFbo()
 {
+    delete m_frameReadback;
+    m_frameReadback = nullptr;
+    delete m_yuvConverter;
+    m_yuvConverter = nullptr;
+    delete m_downsampler;
+    m_downsampler = nullptr;
     delete m_fbo;
     m_fbo = nullptr;
 }
 
-void RenderJobOpenGlThreaded::saveImage(const QImage& image, const QString& outputFile)
+void RenderJobOpenGlThreaded::saveImage(const QImage& image, int frameNumber)
 {
-    const auto a = QUrl::fromUserInput(outputFile).toLocalFile();
-    qInfo() << "Save:" << image.save(a);
+    if (!m_skipUnchangedFrames) {
+        enqueueFrames(image, { frameNumber });
+        return;
+    }
+
+    // Hold the frame back until the frames reusing it are known, the readback
+    // ring hands it over after those were skipped.
+    flushPendingImage();
+    m_pendingImage = image;
+    m_pendingFrame = frameNumber;
 }
 
-void RenderJobOpenGlThreaded::run()
+void RenderJobOpenGlThreaded::flushPendingImage()
 {
-    startRendering();
+    if (m_pendingFrame < 0)
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    const QList<int> frames = QList<int> { m_pendingFrame } + m_duplicateFrames.take(m_pendingFrame);
+    lock.unlock();
+    enqueueFrames(m_pendingImage, frames);
+
+    m_pendingImage = QImage();
+    m_pendingFrame = -1;
 }
-void RenderJobOpenGlThreaded::renderNext()
-{
-    // Q_ASSERT(QThread::currentThread() == thread());
 
+void RenderJobOpenGlThreaded::run()
+{
     if (!m_context->makeCurrent(m_offscreenSurface)) {
         qFatal("Unable to make context current on offscreen surface");
         return;
     }
+    if (!m_renderControlInitialized && !m_renderControl->initialize()) {
+        qFatal("Unable to initialize QQuickRenderControl");
+        return;
+    }
+    m_renderControlInitialized = true;
+
+    forever {
+        QMutexLocker lock(&m_mutex);
+        while (m_requestedFrame == m_syncedFrame && !m_stopRequested)
+            m_requestCond.wait(&m_mutex);
+        if (m_requestedFrame == m_syncedFrame)
+            break;
+
+        // The owner is blocked in renderNext() for the duration of the sync.
+        const int frameNumber = m_requestedFrame;
+        {
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::BeginFrame, frameNumber);
+            m_renderControl->beginFrame();
+        }
+        {
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Sync, frameNumber);
+            m_renderControl->sync();
+        }
+        // Changes from here on belong to the next frame.
+        m_sceneDirty = false;
+        m_syncedFrame = frameNumber;
+        m_cond.wakeOne();
+        lock.unlock();
+
+        renderFrame(frameNumber);
+    }
 
-    // Polishing happens on the gui thread.
-    m_renderControl->polishItems();
-    m_renderControl->beginFrame();
-    // If a dedicated render thread is used, the GUI thread should be blocked for the duration of this call.
-
-    // QMutexLocker lock(&m_mutex);
-    //  m_qmlEngine->requestRender();
-    m_renderControl->sync();
-
-    // The gui thread can now continue.
-    m_cond.wakeOne();
-    // lock.unlock();
-
-    m_renderControl->render();
-    m_renderControl->endFrame();
-    m_context->functions()->glFlush();
+    // The scene graph stays initialized for the next run, the destructor releases it.
+    if (m_outputOpen)
+        cleanup();
+    m_context->doneCurrent();
+    // Hand the context back for the destructor.
+    m_context->moveToThread(QCoreApplication::instance()->thread());
+}
 
+bool RenderJobOpenGlThreaded::renderNext()
+{
     m_currentFrame++;
 
-    QString outputFile(m_outputDirectory + QDir::separator() + m_outputName + "_" + QString::number(m_currentFrame) + "." + m_outputFormat);
-    const auto imageFrameUrl = QUrl::fromUserInput(outputFile).toLocalFile();
-    auto image = m_fbo->toImage();
-    qInfo() << "Save:" << image.save(imageFrameUrl) << "to:" << imageFrameUrl;
-
-    // QFutureWatcher<void>* watcher = new QFutureWatcher<void>();
-    // connect(watcher, SIGNAL(finished()), this, SLOT(futureFinished()));
-    // watcher->setFuture(
-    //     QtConcurrent::run());
-    // m_futures.append(watcher);
+    // Nothing changed since the last sync, reuse the previous output.
+    if (m_skipUnchangedFrames && !m_sceneDirty && m_lastRenderedFrame >= 0) {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_duplicateFrames[m_lastRenderedFrame].append(m_currentFrame);
+        }
+        emit skippedFramesChanged(++m_skippedFrames);
+    } else {
+        {
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Polish, m_currentFrame);
+            m_renderControl->polishItems();
+        }
+        // Stay blocked until the render thread synced, the previous frame may still be rendering.
+        QMutexLocker lock(&m_mutex);
+        m_requestedFrame = m_currentFrame;
+        m_requestCond.wakeOne();
+        while (m_syncedFrame != m_currentFrame)
+            m_cond.wait(&m_mutex);
+        m_lastRenderedFrame = m_currentFrame;
+    }
 
-    // advance animation
+    // Advance the animation for the next frame while this one renders.
     m_animationDriver->advance();
-    emit progressChanged((m_currentFrame / m_frames) * 100);
+    if (m_metrics)
+        RenderMetrics::add(m_metrics->renderedFrames, 1);
+    emit progressChanged(rangePercent(m_currentFrame - m_startFrame));
+
+    return m_currentFrame < m_endFrame;
+}
+
+void RenderJobOpenGlThreaded::renderFrame(int frameNumber)
+{
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Render, frameNumber);
+        m_renderControl->render();
+    }
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::EndFrame, frameNumber);
+        m_renderControl->endFrame();
+        m_context->functions()->glFlush();
+    }
 
-    if (m_currentFrame < m_frames) {
-        renderNext();
+    QOpenGLFramebufferObject* outputFbo = m_fbo;
+    if (m_downsampler) {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Downsample, frameNumber);
+        outputFbo = m_downsampler->downsample(m_fbo);
+    }
+    QOpenGLFramebufferObject* readbackFbo = outputFbo;
+    if (m_yuvConverter) {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::YuvConversion, frameNumber);
+        readbackFbo = m_yuvConverter->convert(outputFbo->texture());
+    }
+    if (m_frameReadback) {
+        // Only map the oldest buffer once the ring is full, the newer reads keep running on the GPU.
+        if (m_frameReadback->isFull()) {
+            const FrameReadback::Frame frame = m_frameReadback->takeOldest();
+            saveImage(frame.image, frame.frameNumber);
+        }
+        m_frameReadback->read(readbackFbo, frameNumber);
     } else {
-        // Finished
-        cleanup();
+        QImage image;
+        {
+            FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Readback, frameNumber);
+            image = m_yuvConverter ? m_yuvConverter->toImage() : FrameReadback::readImage(outputFbo, FrameEncoder::preferredImageFormat(m_outputFormat));
+        }
+        saveImage(image, frameNumber);
     }
 }
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "FrameReadback.h"
+#include "GpuDownsampler.h"
+#include "GpuYuvConverter.h"
+#include "RenderJobBase.h"
 #include "animationdriver.h"
 #include <QCoreApplication>
-#include <QDir>
 #include <QEvent>
 #include <QFuture>
+#include <QMutex>
 #include <QObject>
 #include <QOffscreenSurface>
 #include <QOpenGLBuffer>
@@ -13,10 +17,7 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLVertexArrayObject>
-#include <QQmlComponent>
-#include <QQmlEngine>
 #include <QQuickGraphicsDevice>
-#include <QQuickItem>
 #include <QQuickRenderControl>
 #include <QQuickRenderTarget>
 #include <QQuickWindow>
@@ -26,60 +27,86 @@
 #include <QThread>
 #include <QTimer>
 #include <QVector>
-#include <QtConcurrent>
+#include <QWaitCondition>
 #include <memory>
 
-class RenderJobOpenGlThreaded : public QThread {
+// Standard threaded render control model: polishing and animations run on the
+// thread that owns the job (the gui thread), the QThread only renders. The
+// owner is blocked during sync and prepares the next frame while the previous
+// one renders and is read back.
+class RenderJobOpenGlThreaded : public QThread, public RenderJobBase {
     Q_OBJECT
 public:
+    explicit RenderJobOpenGlThreaded(QObject* parent = 0);
     ~RenderJobOpenGlThreaded();
-    QSize m_size;
-    QString m_outputName;
-    QString m_outputFormat;
-    QString m_outputDirectory;
-    QString m_qmlFile;
-    qreal m_dpr = 0;
-    int m_fps = 0;
-    int m_frames = 0;
-    int m_currentFrame = 0;
-    int m_duration = 0;
-
-    QWaitCondition* cond() { return &m_cond; }
-    QMutex* mutex() { return &m_mutex; }
+    // Read frames back through a ring of pixel buffer objects instead of QOpenGLFramebufferObject::toImage()
+    bool m_asyncReadback = true;
+    int m_readbackBufferCount = 2;
+    // Convert to yuv420p on the GPU before readback for y4m/pipe output
+    bool m_gpuYuv = false;
+    // Same as RenderJobOpenGl
+    int m_samples = 0;
+    int m_supersample = 1;
 
 public:
+    // Both on the owner thread, startRendering() starts the render thread.
     bool initRendering();
+    bool isInitialized() const { return m_renderControl; }
+    // Can be called again once finished(), the context, window and engine are
+    // reused. Pausing stops before the next frame is polished.
     void startRendering();
-    void renderNext();
 
 protected:
+    // Render thread: syncs and renders the frames requested by renderNext().
     void run() override;
 signals:
     // void statusChanged(Status status);
     void progressChanged(int progress);
+    void fileProgressChanged(int fileProgress);
+    void skippedFramesChanged(int skippedFrames);
 
 private:
-    bool loadQml();
+    // Starts the render thread without frames, it stops right away and finished() is emitted.
+    void failRendering();
+    // Owner side of one frame, false after the last one
+    bool renderNext();
+    // Lets the render thread drain its frames and stop, the only way out of run().
+    void finishRendering();
     void cleanup();
-    void initFbo();
+    // False when the frame does not fit into one fbo
+    bool initFbo();
     void destroyFbo();
-    void saveImage(const QImage& image, const QString& outputFile);
+    void renderFrame(int frameNumber);
+    void saveImage(const QImage& image, int frameNumber);
+    void flushPendingImage();
 
 private:
     // Must be created from main (gui) thread
     QQuickRenderControl* m_renderControl = nullptr;
     QQuickWindow* m_quickWindow = nullptr;
-    // Must be created in the separate thread
-    QOpenGLFramebufferObject* m_fbo = nullptr;
+    // Created on the gui thread, current on the render thread while rendering
     QOpenGLContext* m_context = nullptr;
     QOffscreenSurface* m_offscreenSurface = nullptr;
-
-    QQmlEngine* m_qmlEngine = nullptr;
-    QQmlComponent* m_qmlComponent = nullptr;
-    QQuickItem* m_rootItem = nullptr;
+    // Created with the readback by the owner before the render thread starts,
+    // which renders into it and destroys it.
+    QOpenGLFramebufferObject* m_fbo = nullptr;
     AnimationDriver* m_animationDriver = nullptr;
+    FrameReadback* m_frameReadback = nullptr;
+    GpuYuvConverter* m_yuvConverter = nullptr;
+    GpuDownsampler* m_downsampler = nullptr;
     QSurfaceFormat m_format;
+    // Set by the owner before the render thread starts, which closes the output.
+    bool m_outputOpen = false;
 
+    // Handoff between owner and render thread, all guarded by m_mutex,
+    // as is m_duplicateFrames while rendering.
+    // m_requestCond wakes the render thread, m_cond the owner after sync.
     QWaitCondition m_cond;
+    QWaitCondition m_requestCond;
     QMutex m_mutex;
+    int m_requestedFrame = 0;
+    int m_syncedFrame = 0;
+    bool m_stopRequested = false;
+    // Render thread only, the scene graph is initialized by the first run()
+    bool m_renderControlInitialized = false;
 };
@@ -0,0 +1,169 @@
+// Copyright (C) The Qt Company Ltd.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "RenderJobSoftware.h"
+
+RenderJobSoftware::RenderJobSoftware(QObject* parent)
+    : QObject(parent)
+    , RenderJobBase(this)
+{
+    QObject::connect(&m_scheduler, &FrameScheduler::finished, this, [this](bool cancelled) {
+        if (cancelled)
+            qInfo() << "Cancelled" << m_outputName << "after" << m_currentFrame - m_startFrame << "frames";
+        cleanup();
+        emit finished();
+    });
+}
+
+RenderJobSoftware::~RenderJobSoftware()
+{
+    delete m_renderControl;
+    delete m_quickWindow;
+    destroyEngine();
+    delete m_animationDriver;
+}
+
+bool RenderJobSoftware::init()
+{
+    if (QQuickWindow::graphicsApi() != QSGRendererInterface::Software) {
+        qWarning("RenderJobSoftware: The software backend was not selected, see MovieRenderer::selectGraphicsApi()");
+        return false;
+    }
+
+    m_renderControl = new QQuickRenderControl();
+    // Direct, the flag is read by the render loop.
+    QObject::connect(
+        m_renderControl, &QQuickRenderControl::sceneChanged, this, [this]() { m_sceneDirty = true; }, Qt::DirectConnection);
+    QObject::connect(
+        m_renderControl, &QQuickRenderControl::renderRequested, this, [this]() { m_sceneDirty = true; }, Qt::DirectConnection);
+
+    m_quickWindow = new QQuickWindow(m_renderControl);
+    if (!m_renderControl->initialize()) {
+        qFatal("Unable to initialize QQuickRenderControl");
+        return false;
+    }
+
+    createEngine(m_quickWindow);
+    // Direct, emitted from the encoder pool.
+    QObject::connect(
+        m_frameEncoder, &FrameEncoder::frameEncoded, this, [this](int encodedFrames) { emit fileProgressChanged(rangePercent(encodedFrames)); },
+        Qt::DirectConnection);
+
+    return true;
+}
+
+void RenderJobSoftware::start()
+{
+    if (m_size.isNull() || m_dpr <= 0) {
+        qFatal("Invalid size or device pixel ratio");
+    }
+
+    if (!loadQml(m_quickWindow)) {
+        qWarning() << "Unable to load" << m_qmlFile;
+        emit finished();
+        return;
+    }
+
+    // The format the software renderer paints in, anything else is converted on every frame.
+    m_image = QImage(m_size * m_dpr, QImage::Format_ARGB32_Premultiplied);
+    m_image.setDevicePixelRatio(m_dpr);
+    m_image.fill(Qt::transparent);
+    m_quickWindow->setRenderTarget(QQuickRenderTarget::fromPaintDevice(&m_image));
+
+    const FrameRate frameRate = FrameRate::fromFps(m_fps);
+    initFrameRange(frameRate);
+    if (!openOutput(frameRate)) {
+        emit finished();
+        return;
+    }
+    prepareRender();
+    m_animationDriver = new AnimationDriver(frameRate);
+    m_animationDriver->install();
+    // Seek instead of stepping through the frames before the requested range.
+    m_animationDriver->seek(m_startFrame);
+    m_scheduler.start([this]() { return renderNext(); });
+}
+
+void RenderJobSoftware::cleanup()
+{
+    m_animationDriver->uninstall();
+    delete m_animationDriver;
+    m_animationDriver = nullptr;
+
+    flushPendingImage();
+    closeOutput();
+}
+
+bool RenderJobSoftware::renderNext()
+{
+    m_currentFrame++;
+
+    // Nothing changed since the last sync, reuse the previous output.
+    if (m_skipUnchangedFrames && !m_sceneDirty && m_lastRenderedFrame >= 0) {
+        m_duplicateFrames[m_lastRenderedFrame].append(m_currentFrame);
+        emit skippedFramesChanged(++m_skippedFrames);
+    } else {
+        renderFrame();
+    }
+
+    m_animationDriver->advance();
+    if (m_metrics)
+        RenderMetrics::add(m_metrics->renderedFrames, 1);
+    emit progressChanged(rangePercent(m_currentFrame - m_startFrame));
+
+    return m_currentFrame < m_endFrame;
+}
+
+void RenderJobSoftware::renderFrame()
+{
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Polish, m_currentFrame);
+        m_renderControl->polishItems();
+    }
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::BeginFrame, m_currentFrame);
+        m_renderControl->beginFrame();
+    }
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Sync, m_currentFrame);
+        m_renderControl->sync();
+    }
+    // Changes from here on belong to the next frame.
+    m_sceneDirty = false;
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::Render, m_currentFrame);
+        m_renderControl->render();
+    }
+    {
+        FrameProfileScope scope(&m_profiler, FrameProfiler::Stage::EndFrame, m_currentFrame);
+        m_renderControl->endFrame();
+    }
+
+    // No readback, the pixels are already in m_image.
+    saveImage(m_image, m_currentFrame);
+    m_lastRenderedFrame = m_currentFrame;
+}
+
+void RenderJobSoftware::saveImage(const QImage& image, int frameNumber)
+{
+    if (!m_skipUnchangedFrames) {
+        enqueueFrames(image, { frameNumber });
+        return;
+    }
+
+    // Hold the frame back until the frames reusing it are known.
+    flushPendingImage();
+    m_pendingImage = image;
+    m_pendingFrame = frameNumber;
+}
+
+void RenderJobSoftware::flushPendingImage()
+{
+    if (m_pendingFrame < 0)
+        return;
+
+    enqueueFrames(m_pendingImage, QList<int> { m_pendingFrame } + m_duplicateFrames.take(m_pendingFrame));
+
+    m_pendingImage = QImage();
+    m_pendingFrame = -1;
+}
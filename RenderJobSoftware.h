@@ -0,0 +1,52 @@
+#pragma once
+
+#include "RenderJobBase.h"
+#include "animationdriver.h"
+#include <QImage>
+#include <QObject>
+#include <QQuickRenderControl>
+#include <QQuickRenderTarget>
+#include <QQuickWindow>
+
+// Renders with the Qt Quick software backend straight into a QImage, without
+// a GL context, fbo or readback. Meant for machines without a usable GPU.
+// The scene graph backend is global, so the process has to select the software
+// backend before its first QQuickWindow, see MovieRenderer::selectGraphicsApi().
+// Shader effects and particles are not supported.
+class RenderJobSoftware : public QObject, public RenderJobBase {
+    Q_OBJECT
+public:
+    explicit RenderJobSoftware(QObject* parent = 0);
+    ~RenderJobSoftware();
+
+public:
+    bool init();
+    bool isInitialized() const { return m_renderControl; }
+    // Same contract as RenderJobOpenGl::start()
+    void start();
+    // Blocks until finished(), for callers on the job's thread.
+    void waitForFinished() { m_scheduler.waitForFinished(); }
+
+signals:
+    void progressChanged(int progress);
+    void fileProgressChanged(int fileProgress);
+    void skippedFramesChanged(int skippedFrames);
+    // Also emitted when cancelled or when the job could not start
+    void finished();
+
+private:
+    // One frame, false after the last one
+    bool renderNext();
+    void renderFrame();
+    void cleanup();
+    void saveImage(const QImage& image, int frameNumber);
+    void flushPendingImage();
+
+private:
+    QQuickRenderControl* m_renderControl = nullptr;
+    QQuickWindow* m_quickWindow = nullptr;
+    // The render target. Handed to the encoder as is, painting the next frame
+    // detaches it, which keeps the unchanged regions the renderer skips.
+    QImage m_image;
+    AnimationDriver* m_animationDriver = nullptr;
+};
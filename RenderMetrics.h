@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+
+// Counters shared by the render jobs and encoders of one MovieRenderer. The
+// threads only do relaxed atomic adds, the gui thread samples them on a timer
+// instead of receiving an event per frame.
+struct RenderMetrics {
+    std::atomic<qint64> totalFrames = 0;
+    std::atomic<qint64> renderedFrames = 0;
+    std::atomic<qint64> encodedFrames = 0;
+    std::atomic<qint64> queuedFrames = 0;
+    std::atomic<qint64> bytesWritten = 0;
+
+    void reset(qint64 frames)
+    {
+        totalFrames = frames;
+        renderedFrames = 0;
+        encodedFrames = 0;
+        queuedFrames = 0;
+        bytesWritten = 0;
+    }
+
+    static void add(std::atomic<qint64>& counter, qint64 value)
+    {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Peak resident set size of the process in bytes, 0 where unknown.
+    static qint64 peakMemory();
+};
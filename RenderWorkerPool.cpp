@@ -0,0 +1,134 @@
+#include "RenderWorkerPool.h"
+
+#include <QCoreApplication>
+#include <QOpenGLContext>
+
+RenderWorkerPool::RenderWorkerPool(QObject* parent)
+    : QObject(parent)
+{
+    m_idleTimer.setSingleShot(true);
+    QObject::connect(&m_idleTimer, &QTimer::timeout, this, &RenderWorkerPool::destroyIdleWorkers);
+}
+
+RenderWorkerPool::~RenderWorkerPool()
+{
+    // Busy workers cancel their job and close its output before they are deleted.
+    const QList<Worker> workers = m_busy + m_idle;
+    for (const Worker& worker : workers)
+        destroyWorker(worker);
+    for (const Worker& worker : workers)
+        worker.thread->wait();
+}
+
+void RenderWorkerPool::setIdleTimeout(int idleTimeoutMs)
+{
+    m_idleTimeout = idleTimeoutMs;
+    destroyIdleWorkers();
+}
+
+bool RenderWorkerPool::isSupported()
+{
+    return QOpenGLContext::supportsThreadedOpenGL();
+}
+
+RenderJobOpenGl* RenderWorkerPool::acquire()
+{
+    Q_ASSERT_X(QThread::currentThread() == QCoreApplication::instance()->thread(), "RenderWorkerPool::acquire",
+        "Offscreen surfaces must be created on the gui thread");
+    Q_ASSERT_X(isSupported(), "RenderWorkerPool::acquire", "Render workers need threaded OpenGL");
+    if (!m_idle.isEmpty()) {
+        const Worker worker = m_idle.takeLast();
+        m_busy.append(worker);
+        return worker.job;
+    }
+
+    Worker worker;
+    worker.job = new RenderJobOpenGl();
+    // The surface has to be created on the gui thread, everything else is created on the worker.
+    worker.job->createOffscreenSurface();
+    worker.thread = new QThread();
+    worker.job->moveToThread(worker.thread);
+    QObject::connect(worker.thread, &QThread::finished, worker.thread, &QObject::deleteLater);
+    worker.thread->start();
+    m_busy.append(worker);
+    return worker.job;
+}
+
+void RenderWorkerPool::run(RenderJobOpenGl* job, std::function<void()> finished)
+{
+    // Queued to the pool's thread, the worker's event loop keeps rendering meanwhile.
+    QObject::connect(
+        job, &RenderJobOpenGl::finished, this, [this, job, finished]() {
+            release(job);
+            finished();
+        },
+        Qt::SingleShotConnection);
+    QMetaObject::invokeMethod(job, [job]() {
+        if (!job->isInitialized() && !job->init()) {
+            emit job->finished();
+            return;
+        }
+        job->start();
+    });
+}
+
+QList<RenderJobOpenGl*> RenderWorkerPool::busyJobs() const
+{
+    QList<RenderJobOpenGl*> jobs;
+    for (const Worker& worker : m_busy)
+        jobs.append(worker.job);
+    return jobs;
+}
+
+void RenderWorkerPool::release(RenderJobOpenGl* job)
+{
+    for (qsizetype i = 0; i < m_busy.size(); ++i) {
+        if (m_busy.at(i).job != job)
+            continue;
+        Worker worker = m_busy.takeAt(i);
+        worker.idleSince.start();
+        m_idle.append(worker);
+        break;
+    }
+    destroyIdleWorkers();
+}
+
+void RenderWorkerPool::destroyWorker(const Worker& worker)
+{
+    // The job owns a context that is current on its thread, so it is deleted there.
+    RenderJobOpenGl* job = worker.job;
+    QThread* thread = worker.thread;
+    QMetaObject::invokeMethod(job, [job, thread]() {
+        const auto destroy = [job, thread]() {
+            delete job;
+            thread->quit();
+        };
+        if (!job->isRunning()) {
+            destroy();
+            return;
+        }
+        // The frames are sliced through the worker's event loop, deleting the job
+        // between two slices would skip cleanup() and leave the stream, archive
+        // or pipe unfinished. Queued, finished() is emitted from the scheduler.
+        QObject::connect(job, &RenderJobOpenGl::finished, job, destroy, Qt::ConnectionType(Qt::QueuedConnection | Qt::SingleShotConnection));
+        job->cancel();
+    });
+}
+
+void RenderWorkerPool::destroyIdleWorkers()
+{
+    if (m_idleTimeout < 0)
+        return;
+
+    qint64 nextTimeout = -1;
+    for (qsizetype i = m_idle.size() - 1; i >= 0; --i) {
+        const qint64 remaining = m_idleTimeout - m_idle.at(i).idleSince.elapsed();
+        if (remaining <= 0) {
+            destroyWorker(m_idle.takeAt(i));
+        } else if (nextTimeout < 0 || remaining < nextTimeout) {
+            nextTimeout = remaining;
+        }
+    }
+    if (nextTimeout >= 0)
+        m_idleTimer.start(int(nextTimeout));
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "RenderJobOpenGl.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <functional>
+
+// Keeps RenderJobOpenGl instances alive on their own threads between renders,
+// so the next job only reloads its QML and, for a new size, its fbo instead of
+// creating a context, render control, window and engine again.
+// Each worker is a thread-affine render loop: the job creates its context,
+// QQuickRenderControl, QQuickWindow and QQmlEngine on the worker thread, whose
+// event loop then polishes, animates and renders without ever exposing the
+// window. Qt only supports that on platforms with threaded OpenGL, see
+// isSupported(), and with the offscreen surface created on the gui thread,
+// which acquire() does. The pool itself must live on the gui thread.
+class RenderWorkerPool : public QObject {
+    Q_OBJECT
+public:
+    explicit RenderWorkerPool(QObject* parent = nullptr);
+    ~RenderWorkerPool();
+
+    // False when the platform cannot use OpenGL contexts on other threads.
+    static bool isSupported();
+
+    // Idle workers are destroyed after this many ms, 0 destroys them right
+    // away and a negative timeout keeps them until the pool is destroyed.
+    void setIdleTimeout(int idleTimeoutMs);
+    int idleTimeout() const { return m_idleTimeout; }
+
+    int workerCount() const { return m_idle.size() + m_busy.size(); }
+    int idleWorkerCount() const { return m_idle.size(); }
+
+    // Returns an idle worker, or a new one. The job lives on its worker thread,
+    // only set its public settings before passing it to run().
+    RenderJobOpenGl* acquire();
+    // Renders the job on its thread. finished is called on the pool's thread,
+    // after which the worker is idle again.
+    void run(RenderJobOpenGl* job, std::function<void()> finished);
+    // Acquired jobs that were not released yet
+    QList<RenderJobOpenGl*> busyJobs() const;
+
+private:
+    struct Worker {
+        RenderJobOpenGl* job = nullptr;
+        QThread* thread = nullptr;
+        QElapsedTimer idleSince;
+    };
+
+    void release(RenderJobOpenGl* job);
+    void destroyWorker(const Worker& worker);
+    void destroyIdleWorkers();
+
+private:
+    QList<Worker> m_idle;
+    QList<Worker> m_busy;
+    QTimer m_idleTimer;
+    int m_idleTimeout = 30000;
+};
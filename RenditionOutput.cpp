@@ -0,0 +1,129 @@
+#include "RenditionOutput.h"
+
+#include <QDir>
+#include <QUrl>
+
+RenditionOutput::RenditionOutput(const QSize& frameSize, const QString& outputFormat, const ImageEncoder::Options& imageOptions)
+    : m_frameSize(frameSize)
+    , m_outputFormat(outputFormat)
+{
+    m_encoder.setImageOptions(imageOptions);
+}
+
+RenditionOutput::~RenditionOutput()
+{
+    close();
+    delete m_downsampler;
+    delete m_frameReadback;
+}
+
+bool RenditionOutput::parse(const QString& rendition, const QString& defaultFormat, QSize* frameSize, QString* outputFormat)
+{
+    const QStringList parts = rendition.trimmed().split(':');
+    const QStringList size = parts.constFirst().split('x');
+    if (parts.size() > 2 || size.size() != 2)
+        return false;
+    *frameSize = QSize(size[0].toInt(), size[1].toInt());
+    *outputFormat = parts.size() == 2 ? parts[1] : defaultFormat;
+    return !frameSize->isEmpty() && !outputFormat->isEmpty();
+}
+
+bool RenditionOutput::open(const QSize& sourceSize, const QString& outputDirectory, const QString& outputName,
+    const FrameRate& frameRate, bool yuvFullRange, int bufferCount)
+{
+    m_outputDirectory = outputDirectory;
+    m_outputName = outputName + "_" + QString::number(m_frameSize.width()) + "x" + QString::number(m_frameSize.height());
+    m_images.clear();
+    if (FrameArchive::isArchiveFormat(m_outputFormat)) {
+        qWarning() << "Renditions are not archived, choose a format for" << m_outputName;
+        return false;
+    }
+
+    if (sourceSize != m_frameSize) {
+        m_downsampler = new GpuDownsampler();
+        if (!m_downsampler->create(sourceSize, m_frameSize))
+            return false;
+    }
+
+    if (bufferCount > 0) {
+        m_frameReadback = new FrameReadback(bufferCount);
+        m_frameReadback->setOutputFormat(FrameEncoder::preferredImageFormat(m_outputFormat));
+        if (!m_frameReadback->create(m_frameSize)) {
+            qWarning() << "Falling back to synchronous readback for" << m_outputName;
+            delete m_frameReadback;
+            m_frameReadback = nullptr;
+        }
+    }
+
+    m_encoder.reset();
+    if (!FrameStream::isStreamFormat(m_outputFormat))
+        return true;
+
+    // The command of a pipe belongs to the main output.
+    if (m_outputFormat == "pipe")
+        m_outputFormat = "y4m";
+    const QString streamFile(m_outputDirectory + QDir::separator() + m_outputName + "." + m_outputFormat);
+    m_frameStream = new FrameStream();
+    m_frameStream->setFullRange(yuvFullRange);
+    if (!m_frameStream->open(m_outputFormat, QUrl::fromUserInput(streamFile).toLocalFile(), QString(), m_frameSize, frameRate)) {
+        delete m_frameStream;
+        m_frameStream = nullptr;
+        return false;
+    }
+    m_encoder.setStream(m_frameStream);
+    return true;
+}
+
+void RenditionOutput::close()
+{
+    m_encoder.waitForFinished();
+    if (m_frameStream) {
+        m_encoder.setStream(nullptr);
+        delete m_frameStream;
+        m_frameStream = nullptr;
+    }
+}
+
+QOpenGLFramebufferObject* RenditionOutput::read(QOpenGLFramebufferObject* source, int frameNumber)
+{
+    QOpenGLFramebufferObject* fbo = m_downsampler ? m_downsampler->downsample(source) : source;
+    if (!m_frameReadback) {
+        m_images.insert(frameNumber, FrameReadback::readImage(fbo, FrameEncoder::preferredImageFormat(m_outputFormat)));
+        return fbo;
+    }
+    if (m_frameReadback->isFull())
+        takeOldest();
+    m_frameReadback->read(fbo, frameNumber);
+    return fbo;
+}
+
+void RenditionOutput::drain()
+{
+    while (m_frameReadback && m_frameReadback->hasPending())
+        takeOldest();
+}
+
+void RenditionOutput::takeOldest()
+{
+    const FrameReadback::Frame frame = m_frameReadback->takeOldest();
+    m_images.insert(frame.frameNumber, frame.image);
+}
+
+void RenditionOutput::save(int frameNumber, const QList<int>& frames)
+{
+    const QImage image = m_images.take(frameNumber);
+    if (image.isNull())
+        return;
+    QStringList outputFiles;
+    for (const int frame : frames)
+        outputFiles.append(outputFile(frame));
+    m_encoder.enqueue(image, outputFiles);
+}
+
+QString RenditionOutput::outputFile(int frameNumber) const
+{
+    if (m_frameStream)
+        return QString();
+    const QString outputFile(m_outputDirectory + QDir::separator() + m_outputName + "_" + QString::number(frameNumber) + "." + m_outputFormat);
+    return QUrl::fromUserInput(outputFile).toLocalFile();
+}
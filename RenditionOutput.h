@@ -0,0 +1,65 @@
+#pragma once
+
+#include "FrameEncoder.h"
+#include "FrameReadback.h"
+#include "FrameStream.h"
+#include "GpuDownsampler.h"
+#include "animationdriver.h"
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QOpenGLFramebufferObject>
+#include <QSize>
+#include <QString>
+
+// One more output of a render job at a smaller size, so several deliverable
+// resolutions come out of a single render. The rendered frame is reduced on
+// the GPU, read back at the rendition's size and written by the rendition's
+// own FrameEncoder to <name>_<width>x<height>_<frame>.<format>, or to
+// <name>_<width>x<height>.<format> for streams.
+// Must be created, used and destroyed with the same context current.
+class RenditionOutput {
+public:
+    RenditionOutput(const QSize& frameSize, const QString& outputFormat, const ImageEncoder::Options& imageOptions);
+    ~RenditionOutput();
+
+    // "1280x720" or "1280x720:y4m", in pixels. The format defaults to defaultFormat
+    // and may carry image options, "1280x720:jpg?quality=85".
+    static bool parse(const QString& rendition, const QString& defaultFormat, QSize* frameSize, QString* outputFormat);
+
+    QSize frameSize() const { return m_frameSize; }
+    QString outputFormat() const { return m_outputFormat; }
+    FrameEncoder* encoder() { return &m_encoder; }
+
+    // sourceSize is the size of the fbos passed to read(), a bufferCount of 0 reads synchronously.
+    bool open(const QSize& sourceSize, const QString& outputDirectory, const QString& outputName,
+        const FrameRate& frameRate, bool yuvFullRange, int bufferCount);
+    // Waits for the encoder and closes the stream.
+    void close();
+
+    // Scales the frame in source down and reads it back. Returns the fbo
+    // holding the rendition, smaller renditions can be scaled from it.
+    QOpenGLFramebufferObject* read(QOpenGLFramebufferObject* source, int frameNumber);
+    // Collects the frames still in flight in the readback ring.
+    void drain();
+    // Encodes the frame read for frameNumber once for all the given frames.
+    void save(int frameNumber, const QList<int>& frames);
+
+private:
+    QString outputFile(int frameNumber) const;
+    void takeOldest();
+
+private:
+    QSize m_frameSize;
+    QString m_outputFormat;
+    QString m_outputDirectory;
+    QString m_outputName;
+    // Null when the source already has the rendition's size
+    GpuDownsampler* m_downsampler = nullptr;
+    // Null for synchronous readback
+    FrameReadback* m_frameReadback = nullptr;
+    FrameStream* m_frameStream = nullptr;
+    FrameEncoder m_encoder;
+    // Read back frames waiting for save()
+    QHash<int, QImage> m_images;
+};
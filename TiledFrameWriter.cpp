@@ -0,0 +1,180 @@
+#include "TiledFrameWriter.h"
+
+#include "FrameStream.h"
+#include "PixelConversion.h"
+
+#include <QDebug>
+
+TiledFrameWriter::~TiledFrameWriter()
+{
+    close();
+}
+
+bool TiledFrameWriter::isSupportedFormat(const QString& outputFormat)
+{
+    return outputFormat == "pam" || outputFormat == "ppm" || isStreamFormat(outputFormat);
+}
+
+bool TiledFrameWriter::open(const QString& outputFormat, const QString& fileName, const QSize& size, const FrameRate& frameRate, bool fullRange)
+{
+    if (outputFormat == "ppm")
+        m_format = Format::Ppm;
+    else if (outputFormat == "rgba")
+        m_format = Format::Rgba;
+    else if (outputFormat == "y4m")
+        m_format = Format::Y4m;
+    else
+        m_format = Format::Pam;
+    m_size = size;
+    m_fullRange = fullRange;
+    m_bytesWritten = 0;
+
+    if (!isStreamFormat(outputFormat))
+        return true;
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qWarning() << "TiledFrameWriter: Unable to open:" << fileName << m_file.errorString();
+        return false;
+    }
+    if (m_format == Format::Y4m) {
+        const QByteArray header = FrameStream::y4mHeader(size, frameRate, fullRange);
+        return write(header.constData(), header.size());
+    }
+    return true;
+}
+
+void TiledFrameWriter::close()
+{
+    m_file.close();
+    m_buffer = QByteArray();
+}
+
+bool TiledFrameWriter::beginFrame(const QString& fileName)
+{
+    m_row = 0;
+    switch (m_format) {
+    case Format::Pam:
+    case Format::Ppm: {
+        m_file.setFileName(fileName);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning() << "TiledFrameWriter: Unable to open:" << fileName << m_file.errorString();
+            return false;
+        }
+        const QByteArray header = m_format == Format::Pam
+            ? QString("P7\nWIDTH %1\nHEIGHT %2\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n").arg(m_size.width()).arg(m_size.height()).toLatin1()
+            : QString("P6\n%1 %2\n255\n").arg(m_size.width()).arg(m_size.height()).toLatin1();
+        return write(header.constData(), header.size());
+    }
+    case Format::Rgba:
+        return true;
+    case Format::Y4m:
+        m_frameOffset = m_file.pos();
+        return write("FRAME\n", 6);
+    }
+    return false;
+}
+
+bool TiledFrameWriter::writeStrip(const QImage& strip)
+{
+    Q_ASSERT(strip.format() == QImage::Format_RGBA8888_Premultiplied);
+    const int width = m_size.width();
+    const int rows = strip.height();
+    if (strip.width() != width || m_row + rows > m_size.height()) {
+        qWarning() << "TiledFrameWriter: Strip" << strip.size() << "at row" << m_row << "does not fit" << m_size;
+        return false;
+    }
+
+    bool written = true;
+    switch (m_format) {
+    case Format::Pam:
+    case Format::Ppm: {
+        const int channels = m_format == Format::Pam ? 4 : 3;
+        m_buffer.resize(qsizetype(width) * rows * channels);
+        uchar* out = reinterpret_cast<uchar*>(m_buffer.data());
+        for (int y = 0; y < rows; ++y) {
+            const uchar* in = strip.constScanLine(y);
+            if (m_format == Format::Pam) {
+                PixelConversion::convertRow(in, out, width, PixelConversion::Conversion::Unpremultiply);
+                out += qsizetype(width) * 4;
+                continue;
+            }
+            for (int x = 0; x < width; ++x, in += 4, out += 3) {
+                out[0] = in[0];
+                out[1] = in[1];
+                out[2] = in[2];
+            }
+        }
+        written = write(m_buffer.constData(), m_buffer.size());
+        break;
+    }
+    case Format::Rgba:
+        for (int y = 0; y < rows && written; ++y)
+            written = write(reinterpret_cast<const char*>(strip.constScanLine(y)), qsizetype(width) * 4);
+        break;
+    case Format::Y4m: {
+        // Luma rows go straight after the rows written so far, the chroma rows
+        // into their place in the planes behind the luma plane.
+        const qsizetype lumaSize = qsizetype(width) * m_size.height();
+        const qsizetype chromaWidth = (width + 1) / 2;
+        const qsizetype chromaSize = chromaWidth * ((m_size.height() + 1) / 2);
+        const qsizetype stripLuma = qsizetype(width) * rows;
+        const qsizetype stripChroma = chromaWidth * ((rows + 1) / 2);
+        m_buffer.resize(stripLuma + 2 * stripChroma);
+        uchar* y = reinterpret_cast<uchar*>(m_buffer.data());
+        FrameStream::convertToYuv420(strip, y, y + stripLuma, y + stripLuma + stripChroma, m_fullRange);
+
+        const qint64 planes = m_frameOffset + 6;
+        const qint64 chromaRow = m_row / 2;
+        written = writeAt(planes + qint64(m_row) * width, m_buffer.constData(), stripLuma)
+            && writeAt(planes + lumaSize + chromaRow * chromaWidth, m_buffer.constData() + stripLuma, stripChroma)
+            && writeAt(planes + lumaSize + chromaSize + chromaRow * chromaWidth, m_buffer.constData() + stripLuma + stripChroma, stripChroma);
+        break;
+    }
+    }
+    m_row += rows;
+    return written;
+}
+
+bool TiledFrameWriter::endFrame()
+{
+    if (m_row != m_size.height())
+        qWarning() << "TiledFrameWriter: Frame ended after" << m_row << "of" << m_size.height() << "rows";
+
+    switch (m_format) {
+    case Format::Pam:
+    case Format::Ppm: {
+        const bool flushed = m_file.flush();
+        m_file.close();
+        return flushed;
+    }
+    case Format::Rgba:
+        return true;
+    case Format::Y4m: {
+        // The next frame follows the chroma planes.
+        const qint64 chromaSize = qint64((m_size.width() + 1) / 2) * ((m_size.height() + 1) / 2);
+        return m_file.seek(m_frameOffset + 6 + qint64(m_size.width()) * m_size.height() + 2 * chromaSize);
+    }
+    }
+    return false;
+}
+
+bool TiledFrameWriter::write(const char* data, qint64 size)
+{
+    const qint64 written = m_file.write(data, size);
+    if (written != size) {
+        qWarning() << "TiledFrameWriter: Write failed:" << m_file.errorString();
+        return false;
+    }
+    m_bytesWritten += written;
+    return true;
+}
+
+bool TiledFrameWriter::writeAt(qint64 position, const char* data, qint64 size)
+{
+    if (!m_file.seek(position)) {
+        qWarning() << "TiledFrameWriter: Seek failed:" << m_file.errorString();
+        return false;
+    }
+    return write(data, size);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "animationdriver.h"
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+// Writes frames that arrive as horizontal strips of premultiplied rgba rows,
+// top to bottom, so a frame never has to be held in memory at once. Used for
+// tiled renders, whose frames can be far larger than a single fbo.
+//  - pam: one <name>_<frame>.pam per frame, straight alpha
+//  - ppm: one <name>_<frame>.ppm per frame, colour composited over black
+//  - rgba: raw premultiplied frames in one file, like FrameStream
+//  - y4m: yuv420p in one file. The chroma planes follow the luma plane, so the
+//    file is written out of order and cannot be a pipe.
+class TiledFrameWriter {
+public:
+    ~TiledFrameWriter();
+
+    static bool isSupportedFormat(const QString& outputFormat);
+    static bool isStreamFormat(const QString& outputFormat) { return outputFormat == "rgba" || outputFormat == "y4m"; }
+
+    // fileName is the stream file for rgba and y4m and ignored otherwise.
+    bool open(const QString& outputFormat, const QString& fileName, const QSize& size, const FrameRate& frameRate, bool fullRange);
+    void close();
+
+    // fileName is the frame's file for pam and ppm and ignored otherwise.
+    bool beginFrame(const QString& fileName);
+    // strip is Format_RGBA8888_Premultiplied, as wide as the frame and at most
+    // as high as the rows still missing. Except for the last one, strips must
+    // have an even height for y4m.
+    bool writeStrip(const QImage& strip);
+    bool endFrame();
+
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+private:
+    enum class Format {
+        Pam,
+        Ppm,
+        Rgba,
+        Y4m,
+    };
+
+    bool write(const char* data, qint64 size);
+    bool writeAt(qint64 position, const char* data, qint64 size);
+
+private:
+    Format m_format = Format::Pam;
+    QFile m_file;
+    QSize m_size;
+    bool m_fullRange = false;
+    // Next row of the current frame
+    int m_row = 0;
+    // Position of the current frame in a y4m stream
+    qint64 m_frameOffset = 0;
+    qint64 m_bytesWritten = 0;
+    // Conversion buffer, sized for one strip
+    QByteArray m_buffer;
+};
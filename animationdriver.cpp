@@ -2,16 +2,63 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #include "animationdriver.h"
 
-AnimationDriver::AnimationDriver(int msPerStep)
-    : m_step(msPerStep)
+#include <QtMath>
+
+FrameRate FrameRate::fromFps(qreal fps)
+{
+    if (fps <= 0)
+        return {};
+
+    // Integer rates and the NTSC family (23.976, 29.97, 59.94 ...) are exact.
+    const qint64 integer = qRound64(fps);
+    if (qAbs(fps - integer) < 0.0005)
+        return { integer, 1 };
+    const qint64 ntsc = qRound64(fps * 1001 / 1000);
+    if (qAbs(fps - ntsc * 1000.0 / 1001) < 0.0005)
+        return { ntsc * 1000, 1001 };
+    return { qRound64(fps * 1000), 1000 };
+}
+
+qint64 FrameRate::frameTime(qint64 frame) const
+{
+    return (frame * 1000 * denominator + numerator / 2) / numerator;
+}
+
+qint64 FrameRate::subFrameTime(qint64 frame, int subFrame, int subFrames) const
+{
+    const qint64 scaledRate = numerator * subFrames;
+    return ((frame * subFrames + subFrame) * 1000 * denominator + scaledRate / 2) / scaledRate;
+}
+
+qint64 FrameRate::frameCount(qint64 durationMs) const
+{
+    return durationMs * numerator / (1000 * denominator);
+}
+
+AnimationDriver::AnimationDriver(const FrameRate& frameRate)
+    : m_frameRate(frameRate)
+    , m_frame(0)
     , m_elapsed(0)
 {
 }
 
 void AnimationDriver::advance()
 {
-    m_elapsed += m_step;
+    m_elapsed = m_frameRate.frameTime(++m_frame);
     advanceAnimation();
 }
 
 qint64 AnimationDriver::elapsed() const { return m_elapsed; }
+
+void AnimationDriver::seek(qint64 frame)
+{
+    m_frame = frame;
+    m_elapsed = m_frameRate.frameTime(m_frame);
+    advanceAnimation();
+}
+
+void AnimationDriver::seekSubFrame(int subFrame, int subFrames)
+{
+    m_elapsed = m_frameRate.subFrameTime(m_frame, subFrame, subFrames);
+    advanceAnimation();
+}
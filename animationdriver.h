@@ -5,14 +5,37 @@
 
 #include <QtCore/QAnimationDriver>
 
+// Exact frame rate as a fraction, 30000/1001 for 29.97 fps.
+struct FrameRate {
+    qint64 numerator = 24;
+    qint64 denominator = 1;
+
+    static FrameRate fromFps(qreal fps);
+
+    // Milliseconds since frame 0, computed from the frame index so that
+    // rounding never accumulates.
+    qint64 frameTime(qint64 frame) const;
+    // Milliseconds of the given fraction of the way from frame to frame + 1.
+    qint64 subFrameTime(qint64 frame, int subFrame, int subFrames) const;
+    qint64 frameCount(qint64 durationMs) const;
+};
+
 class AnimationDriver : public QAnimationDriver {
 public:
-    AnimationDriver(int msPerStep);
+    AnimationDriver(const FrameRate& frameRate);
 
     void advance() override;
     qint64 elapsed() const override;
 
+    // Jumps straight to the given frame without stepping through the ones in between.
+    void seek(qint64 frame);
+    // Moves to a point between the current and the next frame for motion blur.
+    // currentFrame() stays, the next advance() continues with the next frame.
+    void seekSubFrame(int subFrame, int subFrames);
+    qint64 currentFrame() const { return m_frame; }
+
 private:
-    int m_step;
+    FrameRate m_frameRate;
+    qint64 m_frame;
     qint64 m_elapsed;
 };
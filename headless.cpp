@@ -0,0 +1,213 @@
+// Copyright (C) The Qt Company Ltd.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+#include "MovieRenderer.h"
+
+// Same parameters as MovieRenderer::renderMovie, plus the frame range.
+struct Job {
+    QString qmlFile;
+    QString filename = "frame";
+    QString outputDirectory = ".";
+    QString outputFormat = "png";
+    QSize size { 1280, 720 };
+    qreal devicePixelRatio = 1.0;
+    int durationMs = 1000;
+    qreal fps = 24;
+    int startFrame = 0;
+    int endFrame = -1;
+    // JSON or CSV list of initial properties, renders one variant per entry
+    QString variantsFile;
+};
+
+static QString absolutePath(const QString& path, const QDir& base)
+{
+    const QUrl url(path);
+    if (url.isLocalFile())
+        return url.toLocalFile();
+    return QFileInfo(base, path).absoluteFilePath();
+}
+
+static Job jobFromJson(const QJsonObject& object, const Job& defaults, const QDir& base)
+{
+    Job job = defaults;
+    job.qmlFile = absolutePath(object.value("qmlFile").toString(job.qmlFile), base);
+    job.filename = object.value("filename").toString(job.filename);
+    job.outputDirectory = absolutePath(object.value("outputDirectory").toString(job.outputDirectory), base);
+    job.outputFormat = object.value("outputFormat").toString(job.outputFormat);
+    job.size.setWidth(object.value("width").toInt(job.size.width()));
+    job.size.setHeight(object.value("height").toInt(job.size.height()));
+    job.devicePixelRatio = object.value("devicePixelRatio").toDouble(job.devicePixelRatio);
+    job.durationMs = object.value("durationMs").toInt(job.durationMs);
+    job.fps = object.value("fps").toDouble(job.fps);
+    job.startFrame = object.value("startFrame").toInt(job.startFrame);
+    job.endFrame = object.value("endFrame").toInt(job.endFrame);
+    if (object.contains("variants"))
+        job.variantsFile = absolutePath(object.value("variants").toString(), base);
+    return job;
+}
+
+// A manifest is a single job object, an array of jobs or {"defaults": {...}, "jobs": [...]}.
+static bool loadManifest(const QString& fileName, const Job& defaults, QList<Job>* jobs)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Unable to open manifest:" << fileName;
+        return false;
+    }
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "Invalid manifest:" << fileName << error.errorString();
+        return false;
+    }
+
+    const QDir base = QFileInfo(fileName).absoluteDir();
+    Job jobDefaults = defaults;
+    QJsonArray array;
+    if (document.isArray()) {
+        array = document.array();
+    } else if (document.object().contains("jobs")) {
+        jobDefaults = jobFromJson(document.object().value("defaults").toObject(), defaults, base);
+        array = document.object().value("jobs").toArray();
+    } else {
+        array.append(document.object());
+    }
+    for (const QJsonValue& value : array)
+        jobs->append(jobFromJson(value.toObject(), jobDefaults, base));
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    // No window is ever shown, don't pay for a real platform connection.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("QmlOffscreenRendererCli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders QML files into image sequences without a user interface.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("qml", "QML file to render, ignored when --manifest is given.", "[qml]");
+    const QCommandLineOption manifestOption({ "m", "manifest" }, "JSON job manifest, renders all jobs in one process.", "file");
+    const QCommandLineOption nameOption({ "n", "name" }, "Prefix of the output files.", "name", "frame");
+    const QCommandLineOption outputOption({ "o", "output" }, "Output directory.", "directory", ".");
+    const QCommandLineOption formatOption({ "f", "format" }, "Output image format, with options like png?level=1&filter=up or jpg?quality=90.", "format", "png");
+    const QCommandLineOption sizeOption({ "s", "size" }, "Output size as WIDTHxHEIGHT.", "size", "1280x720");
+    const QCommandLineOption dprOption("dpr", "Device pixel ratio.", "ratio", "1");
+    const QCommandLineOption durationOption({ "d", "duration" }, "Duration in milliseconds.", "ms", "1000");
+    const QCommandLineOption fpsOption("fps", "Frames per second, 29.97 and friends are supported.", "fps", "24");
+    const QCommandLineOption startOption("start", "First frame to render.", "frame", "0");
+    const QCommandLineOption endOption("end", "Frame to stop before, -1 renders until the end.", "frame", "-1");
+    const QCommandLineOption instancesOption("instances", "Number of parallel render instances.", "count", "1");
+    const QCommandLineOption variantsOption("variants", "JSON array or CSV file of initial properties, renders one variant per entry.", "file");
+    const QCommandLineOption precompileOption("precompile", "Compile all QML files below a directory into the QML disk cache first.", "directory");
+    const QCommandLineOption profileOption("profile", "Write per stage frame timings to <name>.trace.json and log percentiles.");
+    const QCommandLineOption tileSizeOption("tile-size", "Render in tiles of this many pixels, 0 only tiles frames beyond the maximum fbo size.", "pixels", "0");
+    const QCommandLineOption samplesOption("samples", "MSAA samples per pixel, 0 disables multisampling.", "count", "0");
+    const QCommandLineOption supersampleOption("supersample", "Render at this multiple of the size and downsample on the GPU.", "factor", "1");
+    const QCommandLineOption motionBlurOption("motion-blur", "Sub-frames averaged into every frame on the GPU, 1 disables motion blur.", "samples", "1");
+    const QCommandLineOption renditionsOption("renditions", "Comma separated smaller outputs scaled on the GPU from the same render, e.g. 1920x1080,1280x720:y4m.", "sizes");
+    const QCommandLineOption softwareOption("software", "Render with the Qt Quick software backend into QImages, without OpenGL.");
+    const QCommandLineOption dedupOption("dedup", "Hard link frames with identical pixels and write a <name>.xxh64 hash index.");
+    parser.addOptions({ manifestOption, nameOption, outputOption, formatOption, sizeOption, dprOption,
+        durationOption, fpsOption, startOption, endOption, instancesOption, variantsOption, precompileOption, dedupOption, profileOption, softwareOption, tileSizeOption, samplesOption, supersampleOption, motionBlurOption, renditionsOption });
+    parser.process(app);
+    // The scene graph backend can only be chosen before the first window exists.
+    MovieRenderer::selectGraphicsApi(parser.isSet(softwareOption));
+
+    const QDir currentDir = QDir::current();
+    Job defaults;
+    defaults.filename = parser.value(nameOption);
+    defaults.outputDirectory = absolutePath(parser.value(outputOption), currentDir);
+    defaults.outputFormat = parser.value(formatOption);
+    const QStringList size = parser.value(sizeOption).split('x');
+    if (size.size() == 2)
+        defaults.size = QSize(size[0].toInt(), size[1].toInt());
+    defaults.devicePixelRatio = parser.value(dprOption).toDouble();
+    defaults.durationMs = parser.value(durationOption).toInt();
+    defaults.fps = parser.value(fpsOption).toDouble();
+    defaults.startFrame = parser.value(startOption).toInt();
+    defaults.endFrame = parser.value(endOption).toInt();
+    if (parser.isSet(variantsOption))
+        defaults.variantsFile = absolutePath(parser.value(variantsOption), currentDir);
+
+    if (parser.isSet(precompileOption)) {
+        QElapsedTimer timer;
+        timer.start();
+        const int compiled = QmlComponentCache::precompile(absolutePath(parser.value(precompileOption), currentDir));
+        qInfo().noquote() << QString("Precompiled %1 QML files in %2 ms").arg(compiled).arg(timer.elapsed());
+        if (!parser.isSet(manifestOption) && parser.positionalArguments().isEmpty())
+            return 0;
+    }
+
+    QList<Job> jobs;
+    if (parser.isSet(manifestOption)) {
+        if (!loadManifest(parser.value(manifestOption), defaults, &jobs))
+            return 1;
+    } else if (!parser.positionalArguments().isEmpty()) {
+        defaults.qmlFile = absolutePath(parser.positionalArguments().constFirst(), currentDir);
+        jobs.append(defaults);
+    } else {
+        parser.showHelp(1);
+    }
+
+    MovieRenderer renderer;
+    renderer.setInstanceCount(parser.value(instancesOption).toInt());
+    renderer.setDeduplicateFrames(parser.isSet(dedupOption));
+    renderer.setProfiling(parser.isSet(profileOption));
+    renderer.setSoftwareRendering(parser.isSet(softwareOption));
+    renderer.setTileSize(parser.value(tileSizeOption).toInt());
+    renderer.setSamples(parser.value(samplesOption).toInt());
+    renderer.setSupersample(parser.value(supersampleOption).toInt());
+    renderer.setMotionBlurSamples(parser.value(motionBlurOption).toInt());
+    if (parser.isSet(renditionsOption))
+        renderer.setRenditions(parser.value(renditionsOption).split(',', Qt::SkipEmptyParts));
+
+    int current = -1;
+    QElapsedTimer timer;
+    QElapsedTimer total;
+    total.start();
+
+    auto renderNextJob = [&]() {
+        if (++current >= jobs.size()) {
+            qInfo().noquote() << QString("Rendered %1 jobs in %2 ms").arg(jobs.size()).arg(total.elapsed());
+            app.quit();
+            return;
+        }
+        const Job& job = jobs[current];
+        QDir().mkpath(job.outputDirectory);
+        renderer.setStartFrame(job.startFrame);
+        renderer.setEndFrame(job.endFrame);
+        timer.start();
+        if (!job.variantsFile.isEmpty()) {
+            renderer.renderVariants(job.qmlFile, job.filename, MovieRenderer::loadVariants(job.variantsFile), job.outputDirectory,
+                job.outputFormat, job.size, job.devicePixelRatio, job.durationMs, job.fps);
+            return;
+        }
+        renderer.renderMovie(job.qmlFile, job.filename, job.outputDirectory, job.outputFormat, job.size,
+            job.devicePixelRatio, job.durationMs, job.fps);
+    };
+
+    // Queued, the single threaded job finishes from within renderMovie().
+    QObject::connect(
+        &renderer, &MovieRenderer::finished, &app, [&]() {
+            qInfo().noquote() << QString("Job %1/%2 %3 finished in %4 ms").arg(current + 1).arg(jobs.size()).arg(jobs[current].qmlFile).arg(timer.elapsed());
+            renderNextJob();
+        },
+        Qt::QueuedConnection);
+
+    QTimer::singleShot(0, &app, renderNextJob);
+    return app.exec();
+}
@@ -9,11 +9,15 @@
 #include <QUrl>
 #include <QtQml/qqmlextensionplugin.h>
 
+#include "MovieRenderer.h"
+
 Q_IMPORT_QML_PLUGIN(QmlOffscreenRendererPlugin)
 
 int main(int argc, char* argv[])
 {
     QGuiApplication app(argc, argv);
+    // Before the application window, which shares the process wide backend.
+    MovieRenderer::selectGraphicsApi(qEnvironmentVariable("QT_QUICK_BACKEND") == "software");
     QQmlApplicationEngine engine;
     // The first subfolder is the libraryName followed by the regular
     // folder strucutre:     LibararyName/Subfolder
@@ -140,14 +140,115 @@ ApplicationWindow {
                     model: [{
                             "value": "png",
                             "text": "png"
+                        }, {
+                            "value": "png?level=1&filter=up",
+                            "text": "png (fast, larger files)"
+                        }, {
+                            "value": "qoi",
+                            "text": "qoi (fast lossless)"
+                        }, {
+                            "value": "tga",
+                            "text": "tga (uncompressed)"
+                        }, {
+                            "value": "ppm",
+                            "text": "ppm (uncompressed, no alpha)"
+                        }, {
+                            "value": "jpg?quality=90",
+                            "text": "jpg (quality 90)"
+                        }, {
+                            "value": "y4m",
+                            "text": "y4m (single file)"
+                        }, {
+                            "value": "rgba",
+                            "text": "raw rgba (single file)"
+                        }, {
+                            "value": "pipe",
+                            "text": "y4m piped into encoder command"
+                        }, {
+                            "value": "archive",
+                            "text": "frame archive (single file)"
+                        }, {
+                            "value": "archivez",
+                            "text": "zlib frame archive (single file)"
                         }]
                 }
             }
 
-            Button {
-                text: "Render Movie"
-                onClicked: {
-                    movieRenderer.renderMovie(qmlFileTextField.text, outputFilenameTextField.text, outputDirectoryTextField.text, imageFormatComboBox.currentValue, Qt.size(widthSpinBox.text, heightSpinBox.text), 1, durationSpinBox.text, fpsSpinBox.text);
+            RowLayout {
+                Layout.fillWidth: true
+                visible: imageFormatComboBox.currentValue === "y4m" || imageFormatComboBox.currentValue === "pipe"
+                CheckBox {
+                    text: "Convert to yuv on the GPU"
+                    checked: movieRenderer.gpuYuvConversion
+                    onToggled: movieRenderer.gpuYuvConversion = checked
+                }
+                CheckBox {
+                    text: "Full range"
+                    checked: movieRenderer.yuvFullRange
+                    onToggled: movieRenderer.yuvFullRange = checked
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                visible: imageFormatComboBox.currentValue === "pipe"
+                Label {
+                    text: "Encoder Command"
+                }
+                TextField {
+                    id: streamCommandTextField
+                    Layout.fillWidth: true
+                    text: "ffmpeg -y -f yuv4mpegpipe -i - -c:v libx264 -crf 18 out.mp4"
+                    onTextChanged: movieRenderer.streamCommand = text
+                    Component.onCompleted: movieRenderer.streamCommand = text
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                CheckBox {
+                    text: "Reuse unchanged frames"
+                    checked: movieRenderer.skipUnchangedFrames
+                    onToggled: movieRenderer.skipUnchangedFrames = checked
+                }
+                CheckBox {
+                    text: "Link identical frames"
+                    checked: movieRenderer.deduplicateFrames
+                    onToggled: movieRenderer.deduplicateFrames = checked
+                }
+                CheckBox {
+                    text: "Profile"
+                    checked: movieRenderer.profiling
+                    onToggled: movieRenderer.profiling = checked
+                }
+                CheckBox {
+                    // Only available when the app was started with QT_QUICK_BACKEND=software
+                    text: "Software rendering"
+                    enabled: GraphicsInfo.api === GraphicsInfo.Software
+                    checked: movieRenderer.softwareRendering
+                    onToggled: movieRenderer.softwareRendering = checked
+                }
+                Label {
+                    visible: movieRenderer.skipUnchangedFrames
+                    text: movieRenderer.skippedFrames + " frames skipped"
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                Button {
+                    text: "Render Movie"
+                    onClicked: {
+                        movieRenderer.renderMovie(qmlFileTextField.text, outputFilenameTextField.text, outputDirectoryTextField.text, imageFormatComboBox.currentValue, Qt.size(widthSpinBox.text, heightSpinBox.text), 1, durationSpinBox.text, fpsSpinBox.text);
+                    }
+                }
+                Button {
+                    text: movieRenderer.paused ? "Resume" : "Pause"
+                    onClicked: movieRenderer.paused = !movieRenderer.paused
+                }
+                Button {
+                    text: "Cancel"
+                    onClicked: movieRenderer.cancel()
                 }
             }
 
@@ -157,6 +258,24 @@ ApplicationWindow {
                 value: movieRenderer.progress
                 to: 100
             }
+
+            ProgressBar {
+                Layout.fillWidth: true
+                from: 0
+                value: movieRenderer.fileProgress
+                to: 100
+            }
+
+            Label {
+                Layout.fillWidth: true
+                text: "render %1 fps, encode %2 fps, %3 queued, %4 MB written, ETA %5, peak memory %6 MB"
+                    .arg(movieRenderer.renderFps.toFixed(1))
+                    .arg(movieRenderer.encodeFps.toFixed(1))
+                    .arg(movieRenderer.queuedFrames)
+                    .arg((movieRenderer.bytesWritten / 1048576).toFixed(1))
+                    .arg(movieRenderer.eta < 0 ? "-" : movieRenderer.eta.toFixed(0) + " s")
+                    .arg((movieRenderer.peakMemory / 1048576).toFixed(0))
+            }
         }
 
         Loader {
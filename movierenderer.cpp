@@ -3,9 +3,77 @@
 
 #include "MovieRenderer.h"
 
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <type_traits>
+
 MovieRenderer::MovieRenderer(QObject* parent)
     : QObject(parent)
 {
+    m_workerPool.setIdleTimeout(m_workerIdleTimeout);
+    m_threadedJobIdleTimer.setSingleShot(true);
+    QObject::connect(&m_threadedJobIdleTimer, &QTimer::timeout, this, [this]() {
+        if (m_renderJobOpenGlThreaded && !m_renderJobOpenGlThreaded->isRunning())
+            m_renderJobOpenGlThreaded.reset();
+    });
+
+    m_metricsTimer.setInterval(metricsInterval);
+    QObject::connect(&m_metricsTimer, &QTimer::timeout, this, &MovieRenderer::updateMetrics);
+    QObject::connect(this, &MovieRenderer::finished, this, [this]() {
+        m_metricsTimer.stop();
+        updateMetrics();
+    });
+}
+
+void MovieRenderer::selectGraphicsApi(bool software)
+{
+    QQuickWindow::setGraphicsApi(software ? QSGRendererInterface::Software : QSGRendererInterface::OpenGL);
+}
+
+template <typename Job>
+void MovieRenderer::configureJob(
+    Job* job,
+    const QString& qmlFile,
+    const QString& filename,
+    const QString& outputDirectory,
+    const QString& outputFormat,
+    const QSize& size,
+    const qreal devicePixelRatio,
+    const int durationMs,
+    const qreal fps)
+{
+    job->m_qmlFile = qmlFile;
+    job->m_initialProperties.clear();
+    job->m_size = size;
+    job->m_frames = FrameRate::fromFps(fps).frameCount(durationMs);
+    job->m_dpr = devicePixelRatio;
+    job->m_duration = durationMs;
+    job->m_fps = fps;
+    job->m_outputName = filename;
+    job->m_outputDirectory = outputDirectory;
+    ImageEncoder::parseFormat(outputFormat, &job->m_outputFormat, &job->m_imageOptions);
+    job->m_encoderThreads = m_encoderThreads;
+    job->m_encoderQueueDepth = m_encoderQueueDepth;
+    job->m_startFrame = m_startFrame;
+    job->m_endFrame = m_endFrame;
+    job->m_streamCommand = m_streamCommand;
+    job->m_yuvFullRange = m_yuvFullRange;
+    // The software job renders straight into a QImage, there is nothing to read back.
+    if constexpr (!std::is_same_v<Job, RenderJobSoftware>) {
+        job->m_asyncReadback = m_asyncReadback;
+        job->m_readbackBufferCount = m_readbackBufferCount;
+        job->m_gpuYuv = m_gpuYuvConversion;
+        job->m_samples = m_samples;
+        job->m_supersample = m_supersample;
+    }
+    if constexpr (std::is_same_v<Job, RenderJobOpenGl>) {
+        job->m_tileSize = m_tileSize;
+        job->m_motionBlurSamples = m_motionBlurSamples;
+        job->m_renditions = m_renditions;
+    }
+    job->m_skipUnchangedFrames = m_skipUnchangedFrames;
+    job->m_deduplicateFrames = m_deduplicateFrames;
+    job->m_metrics = &m_metrics;
 }
 
 void MovieRenderer::renderMovie(
@@ -16,7 +84,7 @@ void MovieRenderer::renderMovie(
     const QSize& size,
     const qreal devicePixelRatio,
     const int durationMs,
-    const int fps)
+    const qreal fps)
 {
     // if (m_status != Status::NotRunning) {
     //     qWarning() << "Already running, abort!";
@@ -24,39 +92,383 @@ void MovieRenderer::renderMovie(
     // }
 
     setProgress(0);
-    m_futureCounter = 0;
+    setFileProgress(0);
+    setSkippedFrames(0);
+    setPaused(false);
+    m_cancelled = false;
+    startMetrics(rangeFrames(durationMs, fps));
+
+    // The backend was chosen for the whole process, the jobs can't switch it.
+    const bool software = QQuickWindow::graphicsApi() == QSGRendererInterface::Software;
+    if (m_softwareRendering != software)
+        qWarning() << "The scene graph backend is chosen once per process, rendering with" << (software ? "software" : "OpenGL");
+    if (software) {
+        if (m_instanceCount > 1)
+            qWarning("Software rendering uses a single instance");
+        m_renderJobSoftware = std::make_unique<RenderJobSoftware>();
+        QObject::connect(m_renderJobSoftware.get(), &RenderJobSoftware::progressChanged, this, &MovieRenderer::setProgress);
+        QObject::connect(m_renderJobSoftware.get(), &RenderJobSoftware::fileProgressChanged, this, &MovieRenderer::setFileProgress);
+        QObject::connect(m_renderJobSoftware.get(), &RenderJobSoftware::skippedFramesChanged, this, &MovieRenderer::setSkippedFrames);
+        QObject::connect(m_renderJobSoftware.get(), &RenderJobSoftware::finished, this, &MovieRenderer::finished);
+        configureJob(m_renderJobSoftware.get(), qmlFile, filename, outputDirectory, outputFormat, size, devicePixelRatio, durationMs, fps);
+        if (!m_renderJobSoftware->init()) {
+            emit finished();
+            return;
+        }
+        m_renderJobSoftware->start();
+        return;
+    }
+
+    // Frame ranges, tiles, motion blur and renditions need RenderJobOpenGl. It
+    // renders on pooled workers where the platform has threaded OpenGL,
+    // otherwise as a single instance on the gui thread. Frames larger than
+    // the maximum fbo size are tiled by it as well.
+    const QSize frameSize = size * devicePixelRatio;
+    const int maxFboSize = RenderJobOpenGl::maxFboSize();
+    const bool oversized = maxFboSize > 0 && qMax(frameSize.width(), frameSize.height()) > maxFboSize;
+    const bool pooled = m_instanceCount > 1 || m_tileSize > 0 || m_motionBlurSamples > 1 || !m_renditions.isEmpty() || oversized;
+    if (pooled && RenderWorkerPool::isSupported()) {
+        int instanceCount = m_instanceCount;
+        // A single stream can only be written in frame order, so it is never sharded.
+        if (instanceCount > 1 && FrameStream::isStreamFormat(outputFormat)) {
+            qWarning() << "Streamed output" << outputFormat << "renders with a single instance";
+            instanceCount = 1;
+        }
+        renderSharded(qmlFile, filename, outputDirectory, outputFormat, size, devicePixelRatio, durationMs, fps, instanceCount);
+        return;
+    }
 
-    bool single_threaded = false;
-    if (single_threaded) {
+    if (pooled) {
+        if (m_instanceCount > 1)
+            qWarning("Render workers need threaded OpenGL, rendering with a single instance");
+        if (m_renderJobOpenGl && m_renderJobOpenGl->isRunning()) {
+            // Same as for the threaded job below. Queued, the job emits finished() from its own scheduler.
+            QObject::disconnect(m_renderJobOpenGl.get(), nullptr, this, nullptr);
+            QObject::connect(
+                m_renderJobOpenGl.get(), &RenderJobOpenGl::finished, this,
+                [=, this]() {
+                    m_renderJobOpenGl.reset();
+                    renderMovie(qmlFile, filename, outputDirectory, outputFormat, size, devicePixelRatio, durationMs, fps);
+                },
+                Qt::ConnectionType(Qt::QueuedConnection | Qt::SingleShotConnection));
+            m_renderJobOpenGl->cancel();
+            return;
+        }
         m_renderJobOpenGl = std::make_unique<RenderJobOpenGl>();
         QObject::connect(m_renderJobOpenGl.get(), &RenderJobOpenGl::progressChanged, this, &MovieRenderer::setProgress);
-        m_renderJobOpenGl->m_qmlFile = qmlFile;
-        m_renderJobOpenGl->m_size = size;
-        m_renderJobOpenGl->m_frames = durationMs / 1000 * fps;
-        m_renderJobOpenGl->m_dpr = devicePixelRatio;
-        m_renderJobOpenGl->m_duration = durationMs;
-        m_renderJobOpenGl->m_fps = fps;
-        m_renderJobOpenGl->m_outputName = filename;
-        m_renderJobOpenGl->m_outputDirectory = outputDirectory;
-        m_renderJobOpenGl->m_outputFormat = outputFormat;
-
-        m_renderJobOpenGl->init();
+        QObject::connect(m_renderJobOpenGl.get(), &RenderJobOpenGl::fileProgressChanged, this, &MovieRenderer::setFileProgress);
+        QObject::connect(m_renderJobOpenGl.get(), &RenderJobOpenGl::skippedFramesChanged, this, &MovieRenderer::setSkippedFrames);
+        QObject::connect(m_renderJobOpenGl.get(), &RenderJobOpenGl::finished, this, &MovieRenderer::finished);
+        configureJob(m_renderJobOpenGl.get(), qmlFile, filename, outputDirectory, outputFormat, size, devicePixelRatio, durationMs, fps);
+
+        if (!m_renderJobOpenGl->init()) {
+            emit finished();
+            return;
+        }
         m_renderJobOpenGl->start();
-    } else {
+        return;
+    }
+
+    // The job of the previous call keeps its context, window and engine until it idled for workerIdleTimeout.
+    m_threadedJobIdleTimer.stop();
+    if (m_renderJobOpenGlThreaded && m_renderJobOpenGlThreaded->isRunning()) {
+        // Cancel the running render and start this one once it closed its
+        // output. Its signals no longer reach the renderer, so it does not
+        // report the new render as finished.
+        QObject::disconnect(m_renderJobOpenGlThreaded.get(), nullptr, this, nullptr);
+        QObject::connect(
+            m_renderJobOpenGlThreaded.get(), &RenderJobOpenGlThreaded::finished, this,
+            [=, this]() {
+                m_renderJobOpenGlThreaded.reset();
+                renderMovie(qmlFile, filename, outputDirectory, outputFormat, size, devicePixelRatio, durationMs, fps);
+            },
+            Qt::SingleShotConnection);
+        m_renderJobOpenGlThreaded->cancel();
+        return;
+    }
+    if (!m_renderJobOpenGlThreaded) {
         m_renderJobOpenGlThreaded = std::make_unique<RenderJobOpenGlThreaded>();
         QObject::connect(m_renderJobOpenGlThreaded.get(), &RenderJobOpenGlThreaded::progressChanged, this, &MovieRenderer::setProgress);
-        m_renderJobOpenGlThreaded->m_qmlFile = qmlFile;
-        m_renderJobOpenGlThreaded->m_size = size;
-        m_renderJobOpenGlThreaded->m_frames = durationMs / 1000 * fps;
-        m_renderJobOpenGlThreaded->m_dpr = devicePixelRatio;
-        m_renderJobOpenGlThreaded->m_duration = durationMs;
-        m_renderJobOpenGlThreaded->m_fps = fps;
-        m_renderJobOpenGlThreaded->m_outputName = filename;
-        m_renderJobOpenGlThreaded->m_outputDirectory = outputDirectory;
-        m_renderJobOpenGlThreaded->m_outputFormat = outputFormat;
-        m_renderJobOpenGlThreaded->initRendering();
-        m_renderJobOpenGlThreaded->start();
+        QObject::connect(m_renderJobOpenGlThreaded.get(), &RenderJobOpenGlThreaded::fileProgressChanged, this, &MovieRenderer::setFileProgress);
+        QObject::connect(m_renderJobOpenGlThreaded.get(), &RenderJobOpenGlThreaded::skippedFramesChanged, this, &MovieRenderer::setSkippedFrames);
+        QObject::connect(m_renderJobOpenGlThreaded.get(), &RenderJobOpenGlThreaded::finished, this, &MovieRenderer::finished);
+        QObject::connect(m_renderJobOpenGlThreaded.get(), &RenderJobOpenGlThreaded::finished, this, &MovieRenderer::startThreadedJobIdleTimer);
+    }
+    configureJob(m_renderJobOpenGlThreaded.get(), qmlFile, filename, outputDirectory, outputFormat, size, devicePixelRatio, durationMs, fps);
+    if (!m_renderJobOpenGlThreaded->isInitialized() && !m_renderJobOpenGlThreaded->initRendering()) {
+        m_renderJobOpenGlThreaded.reset();
+        emit finished();
+        return;
+    }
+    m_renderJobOpenGlThreaded->startRendering();
+}
+
+void MovieRenderer::renderSharded(
+    const QString& qmlFile,
+    const QString& filename,
+    const QString& outputDirectory,
+    const QString& outputFormat,
+    const QSize& size,
+    const qreal devicePixelRatio,
+    const int durationMs,
+    const qreal fps,
+    const int instanceCount)
+{
+    const int frames = FrameRate::fromFps(fps).frameCount(durationMs);
+    const int first = qBound(0, m_startFrame, frames);
+    const int last = m_endFrame < 0 ? frames : qBound(first, m_endFrame, frames);
+    const int shardCount = qBound(1, instanceCount, qMax(1, last - first));
+
+    m_shards = QVector<Shard>(shardCount);
+    m_runningShards = shardCount;
+
+    for (int i = 0; i < shardCount; ++i) {
+        // Every shard gets its own render control, window, engine, context and fbo.
+        RenderJobOpenGl* job = m_workerPool.acquire();
+        configureJob(job, qmlFile, filename, outputDirectory, outputFormat, size, devicePixelRatio, durationMs, fps);
+        // Contiguous ranges so every shard only seeks once, file numbering stays global.
+        job->m_startFrame = first + (last - first) * i / shardCount;
+        job->m_endFrame = first + (last - first) * (i + 1) / shardCount;
+        // Share the encoder budget instead of starting a full pool per shard.
+        job->m_encoderThreads = qMax(1, m_encoderThreads / shardCount);
+        job->m_encoderQueueDepth = qMax(1, m_encoderQueueDepth / shardCount);
+        m_shards[i].frames = job->m_endFrame - job->m_startFrame;
+        job->setPaused(m_paused);
+
+        QObject::connect(job, &RenderJobOpenGl::progressChanged, this, [this, i](int progress) {
+            m_shards[i].progress = progress;
+            updateShardProgress();
+        });
+        QObject::connect(job, &RenderJobOpenGl::fileProgressChanged, this, [this, i](int fileProgress) {
+            m_shards[i].fileProgress = fileProgress;
+            updateShardProgress();
+        });
+        QObject::connect(job, &RenderJobOpenGl::skippedFramesChanged, this, [this, i](int skippedFrames) {
+            m_shards[i].skippedFrames = skippedFrames;
+            updateShardProgress();
+        });
+        m_workerPool.run(job, [this, job]() {
+            QObject::disconnect(job, nullptr, this, nullptr);
+            if (--m_runningShards == 0)
+                emit finished();
+        });
+    }
+}
+
+void MovieRenderer::renderVariants(
+    const QString& qmlFile,
+    const QString& filename,
+    const QVariantList& variants,
+    const QString& outputDirectory,
+    const QString& outputFormat,
+    const QSize& size,
+    const qreal devicePixelRatio,
+    const int durationMs,
+    const qreal fps)
+{
+    if (variants.isEmpty()) {
+        qWarning("No variants to render");
+        emit finished();
+        return;
+    }
+    if (QQuickWindow::graphicsApi() == QSGRendererInterface::Software) {
+        qWarning("Variants render on pooled OpenGL workers, not with the software backend");
+        emit finished();
+        return;
+    }
+    if (!RenderWorkerPool::isSupported()) {
+        qWarning("Variants render on pooled workers, which need threaded OpenGL");
+        emit finished();
+        return;
+    }
+    setProgress(0);
+    setFileProgress(0);
+    setPaused(false);
+    m_cancelled = false;
+    startMetrics(qint64(rangeFrames(durationMs, fps)) * variants.size());
+    m_variantBatch = VariantBatch();
+    m_variantBatch.qmlFile = qmlFile;
+    m_variantBatch.filename = filename;
+    m_variantBatch.variants = variants;
+    m_variantBatch.outputDirectory = outputDirectory;
+    m_variantBatch.outputFormat = outputFormat;
+    m_variantBatch.size = size;
+    m_variantBatch.devicePixelRatio = devicePixelRatio;
+    m_variantBatch.durationMs = durationMs;
+    m_variantBatch.fps = fps;
+    m_variantBatch.timer.start();
+
+    // Keep the workers warm between variants even if reuse is disabled otherwise.
+    m_workerPool.setIdleTimeout(-1);
+    const int workers = qBound(1, m_instanceCount, int(variants.size()));
+    for (int i = 0; i < workers; ++i)
+        renderNextVariant();
+}
+
+void MovieRenderer::renderNextVariant()
+{
+    VariantBatch& batch = m_variantBatch;
+    if (m_cancelled)
+        batch.next = batch.variants.size();
+    if (batch.next >= batch.variants.size()) {
+        if (batch.running > 0)
+            return;
+        qInfo().noquote() << QString("Rendered %1 variants in %2 ms, %3 variants per minute")
+                                 .arg(batch.finished)
+                                 .arg(batch.timer.elapsed())
+                                 .arg(m_variantsPerMinute, 0, 'f', 1);
+        m_workerPool.setIdleTimeout(m_workerIdleTimeout);
+        emit finished();
+        return;
     }
+
+    const int index = batch.next++;
+    batch.running++;
+    RenderJobOpenGl* job = m_workerPool.acquire();
+    configureJob(job, batch.qmlFile, batch.filename + "_" + QString::number(index), batch.outputDirectory, batch.outputFormat,
+        batch.size, batch.devicePixelRatio, batch.durationMs, batch.fps);
+    job->m_initialProperties = batch.variants.at(index).toMap();
+    // Variants run side by side, each only gets its share of the encoder budget.
+    const int workers = qMax(1, qMin(m_instanceCount, int(batch.variants.size())));
+    job->m_encoderThreads = qMax(1, m_encoderThreads / workers);
+    job->m_encoderQueueDepth = qMax(1, m_encoderQueueDepth / workers);
+    job->setPaused(m_paused);
+
+    m_workerPool.run(job, [this]() {
+        VariantBatch& batch = m_variantBatch;
+        batch.running--;
+        batch.finished++;
+        setProgress(batch.finished * 100 / int(batch.variants.size()));
+        const qreal minutes = batch.timer.elapsed() / 60000.0;
+        if (minutes > 0 && m_variantsPerMinute != batch.finished / minutes) {
+            m_variantsPerMinute = batch.finished / minutes;
+            emit variantsPerMinuteChanged(m_variantsPerMinute);
+        }
+        renderNextVariant();
+    });
+}
+
+QVariantList MovieRenderer::loadVariants(const QString& fileName)
+{
+    QFile file(QUrl::fromUserInput(fileName).toLocalFile());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Unable to open variants:" << fileName;
+        return {};
+    }
+
+    if (!fileName.endsWith(".csv", Qt::CaseInsensitive)) {
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+        if (error.error != QJsonParseError::NoError || !document.isArray()) {
+            qWarning() << "Variants must be a JSON array of objects:" << fileName << error.errorString();
+            return {};
+        }
+        return document.array().toVariantList();
+    }
+
+    // RFC 4180: comma separated records, quoted fields may contain commas and
+    // line breaks, "" is an escaped quote. Blank lines are skipped.
+    const QString text = QString::fromUtf8(file.readAll());
+    QList<QStringList> records;
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const QChar c = text.at(i);
+        if (quoted && c == '"' && i + 1 < text.size() && text.at(i + 1) == '"') {
+            field += c;
+            ++i;
+        } else if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            fields.append(field);
+            field.clear();
+        } else if ((c == '\n' || c == '\r') && !quoted) {
+            if (!fields.isEmpty() || !field.isEmpty())
+                records.append(fields << field);
+            fields.clear();
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    if (!fields.isEmpty() || !field.isEmpty())
+        records.append(fields << field);
+    if (records.isEmpty())
+        return {};
+
+    QVariantList variants;
+    const QStringList header = records.takeFirst();
+    for (const QStringList& record : std::as_const(records)) {
+        QVariantMap variant;
+        for (qsizetype i = 0; i < header.size() && i < record.size(); ++i)
+            variant.insert(header.at(i).trimmed(), record.at(i));
+        variants.append(variant);
+    }
+    return variants;
+}
+
+int MovieRenderer::rangeFrames(const int durationMs, const qreal fps) const
+{
+    const int frames = FrameRate::fromFps(fps).frameCount(durationMs);
+    const int first = qBound(0, m_startFrame, frames);
+    const int last = m_endFrame < 0 ? frames : qBound(first, m_endFrame, frames);
+    return last - first;
+}
+
+void MovieRenderer::startMetrics(qint64 totalFrames)
+{
+    m_metrics.reset(totalFrames);
+    m_lastRenderedFrames = 0;
+    m_lastEncodedFrames = 0;
+    m_renderFps = 0;
+    m_encodeFps = 0;
+    m_eta = -1;
+    m_metricsClock.start();
+    m_metricsTimer.start();
+    updateMetrics();
+}
+
+void MovieRenderer::updateMetrics()
+{
+    const qint64 elapsed = m_metricsClock.restart();
+    const qint64 renderedFrames = m_metrics.renderedFrames.load(std::memory_order_relaxed);
+    const qint64 encodedFrames = m_metrics.encodedFrames.load(std::memory_order_relaxed);
+
+    if (elapsed > 0) {
+        // Smoothed over a few samples, encoders finish in bursts.
+        auto smooth = [](qreal previous, qreal current) { return previous > 0 ? 0.6 * previous + 0.4 * current : current; };
+        m_renderFps = smooth(m_renderFps, (renderedFrames - m_lastRenderedFrames) * 1000.0 / elapsed);
+        m_encodeFps = smooth(m_encodeFps, (encodedFrames - m_lastEncodedFrames) * 1000.0 / elapsed);
+    }
+    m_lastRenderedFrames = renderedFrames;
+    m_lastEncodedFrames = encodedFrames;
+
+    m_queuedFrames = m_metrics.queuedFrames.load(std::memory_order_relaxed);
+    m_bytesWritten = m_metrics.bytesWritten.load(std::memory_order_relaxed);
+    const qint64 remaining = qMax<qint64>(0, m_metrics.totalFrames - encodedFrames);
+    m_eta = remaining == 0 ? 0 : (m_encodeFps > 0 ? remaining / m_encodeFps : -1);
+    m_peakMemory = RenderMetrics::peakMemory();
+    emit metricsChanged();
+}
+
+void MovieRenderer::updateShardProgress()
+{
+    qint64 frames = 0;
+    qint64 progress = 0;
+    qint64 fileProgress = 0;
+    int skippedFrames = 0;
+    for (const Shard& shard : m_shards) {
+        skippedFrames += shard.skippedFrames;
+        frames += shard.frames;
+        progress += qint64(shard.progress) * shard.frames;
+        fileProgress += qint64(shard.fileProgress) * shard.frames;
+    }
+    setSkippedFrames(skippedFrames);
+    if (frames == 0)
+        return;
+    setProgress(progress / frames);
+    setFileProgress(fileProgress / frames);
 }
 
 int MovieRenderer::progress() const { return m_progress; }
@@ -69,25 +481,268 @@ void MovieRenderer::setProgress(int progress)
     emit progressChanged(progress);
 }
 
-void MovieRenderer::futureFinished()
+int MovieRenderer::fileProgress() const { return m_fileProgress; }
+
+void MovieRenderer::setFileProgress(int fileProgress)
 {
-    m_futureCounter++;
-    if (m_futureCounter == (m_renderJobOpenGl->m_frames - 1)) {
-        qDeleteAll(m_futures);
-        m_futures.clear();
-        // m_status = Status::NotRunning;
-        emit finished();
-    }
+    if (m_fileProgress == fileProgress)
+        return;
+    m_fileProgress = fileProgress;
+    emit fileProgressChanged(fileProgress);
 }
 
-bool MovieRenderer::event(QEvent* event)
+int MovieRenderer::encoderThreads() const { return m_encoderThreads; }
+
+void MovieRenderer::setEncoderThreads(int encoderThreads)
 {
-    if (event->type() == QEvent::UpdateRequest) {
-        m_renderJobOpenGl->renderNext();
-        return true;
-    }
+    if (m_encoderThreads == encoderThreads)
+        return;
+    m_encoderThreads = encoderThreads;
+    emit encoderThreadsChanged(encoderThreads);
+}
 
-    return QObject::event(event);
+int MovieRenderer::encoderQueueDepth() const { return m_encoderQueueDepth; }
+
+void MovieRenderer::setEncoderQueueDepth(int encoderQueueDepth)
+{
+    if (m_encoderQueueDepth == encoderQueueDepth)
+        return;
+    m_encoderQueueDepth = encoderQueueDepth;
+    emit encoderQueueDepthChanged(encoderQueueDepth);
+}
+
+bool MovieRenderer::asyncReadback() const { return m_asyncReadback; }
+
+void MovieRenderer::setAsyncReadback(bool asyncReadback)
+{
+    if (m_asyncReadback == asyncReadback)
+        return;
+    m_asyncReadback = asyncReadback;
+    emit asyncReadbackChanged(asyncReadback);
+}
+
+int MovieRenderer::readbackBufferCount() const { return m_readbackBufferCount; }
+
+void MovieRenderer::setReadbackBufferCount(int readbackBufferCount)
+{
+    if (m_readbackBufferCount == readbackBufferCount)
+        return;
+    m_readbackBufferCount = readbackBufferCount;
+    emit readbackBufferCountChanged(readbackBufferCount);
+}
+
+int MovieRenderer::startFrame() const { return m_startFrame; }
+
+void MovieRenderer::setStartFrame(int startFrame)
+{
+    if (m_startFrame == startFrame)
+        return;
+    m_startFrame = startFrame;
+    emit startFrameChanged(startFrame);
+}
+
+int MovieRenderer::endFrame() const { return m_endFrame; }
+
+void MovieRenderer::setEndFrame(int endFrame)
+{
+    if (m_endFrame == endFrame)
+        return;
+    m_endFrame = endFrame;
+    emit endFrameChanged(endFrame);
+}
+
+int MovieRenderer::instanceCount() const { return m_instanceCount; }
+
+void MovieRenderer::setInstanceCount(int instanceCount)
+{
+    if (m_instanceCount == instanceCount)
+        return;
+    m_instanceCount = instanceCount;
+    emit instanceCountChanged(instanceCount);
+}
+
+QString MovieRenderer::streamCommand() const { return m_streamCommand; }
+
+void MovieRenderer::setStreamCommand(const QString& streamCommand)
+{
+    if (m_streamCommand == streamCommand)
+        return;
+    m_streamCommand = streamCommand;
+    emit streamCommandChanged(streamCommand);
+}
+
+bool MovieRenderer::gpuYuvConversion() const { return m_gpuYuvConversion; }
+
+void MovieRenderer::setGpuYuvConversion(bool gpuYuvConversion)
+{
+    if (m_gpuYuvConversion == gpuYuvConversion)
+        return;
+    m_gpuYuvConversion = gpuYuvConversion;
+    emit gpuYuvConversionChanged(gpuYuvConversion);
+}
+
+bool MovieRenderer::yuvFullRange() const { return m_yuvFullRange; }
+
+void MovieRenderer::setYuvFullRange(bool yuvFullRange)
+{
+    if (m_yuvFullRange == yuvFullRange)
+        return;
+    m_yuvFullRange = yuvFullRange;
+    emit yuvFullRangeChanged(yuvFullRange);
+}
+
+bool MovieRenderer::skipUnchangedFrames() const { return m_skipUnchangedFrames; }
+
+void MovieRenderer::setSkipUnchangedFrames(bool skipUnchangedFrames)
+{
+    if (m_skipUnchangedFrames == skipUnchangedFrames)
+        return;
+    m_skipUnchangedFrames = skipUnchangedFrames;
+    emit skipUnchangedFramesChanged(skipUnchangedFrames);
+}
+
+int MovieRenderer::skippedFrames() const { return m_skippedFrames; }
+
+bool MovieRenderer::softwareRendering() const { return m_softwareRendering; }
+
+void MovieRenderer::setSoftwareRendering(bool softwareRendering)
+{
+    if (m_softwareRendering == softwareRendering)
+        return;
+    m_softwareRendering = softwareRendering;
+    emit softwareRenderingChanged(softwareRendering);
+}
+
+int MovieRenderer::tileSize() const { return m_tileSize; }
+
+void MovieRenderer::setTileSize(int tileSize)
+{
+    if (m_tileSize == tileSize)
+        return;
+    m_tileSize = tileSize;
+    emit tileSizeChanged(tileSize);
+}
+
+int MovieRenderer::samples() const { return m_samples; }
+
+void MovieRenderer::setSamples(int samples)
+{
+    if (m_samples == samples)
+        return;
+    m_samples = samples;
+    emit samplesChanged(samples);
+}
+
+int MovieRenderer::supersample() const { return m_supersample; }
+
+void MovieRenderer::setSupersample(int supersample)
+{
+    if (m_supersample == supersample)
+        return;
+    m_supersample = supersample;
+    emit supersampleChanged(supersample);
+}
+
+int MovieRenderer::motionBlurSamples() const { return m_motionBlurSamples; }
+
+void MovieRenderer::setMotionBlurSamples(int motionBlurSamples)
+{
+    if (m_motionBlurSamples == motionBlurSamples)
+        return;
+    m_motionBlurSamples = motionBlurSamples;
+    emit motionBlurSamplesChanged(motionBlurSamples);
+}
+
+QStringList MovieRenderer::renditions() const { return m_renditions; }
+
+void MovieRenderer::setRenditions(const QStringList& renditions)
+{
+    if (m_renditions == renditions)
+        return;
+    m_renditions = renditions;
+    emit renditionsChanged(renditions);
+}
+
+bool MovieRenderer::paused() const { return m_paused; }
+
+void MovieRenderer::setPaused(bool paused)
+{
+    if (m_paused == paused)
+        return;
+    m_paused = paused;
+    if (m_renderJobOpenGl)
+        m_renderJobOpenGl->setPaused(paused);
+    if (m_renderJobOpenGlThreaded)
+        m_renderJobOpenGlThreaded->setPaused(paused);
+    if (m_renderJobSoftware)
+        m_renderJobSoftware->setPaused(paused);
+    // Thread safe, the pooled jobs pick it up before their next frame.
+    for (RenderJobOpenGl* job : m_workerPool.busyJobs())
+        job->setPaused(paused);
+    emit pausedChanged(paused);
+}
+
+void MovieRenderer::cancel()
+{
+    m_cancelled = true;
+    if (m_renderJobOpenGl)
+        m_renderJobOpenGl->cancel();
+    if (m_renderJobOpenGlThreaded)
+        m_renderJobOpenGlThreaded->cancel();
+    if (m_renderJobSoftware)
+        m_renderJobSoftware->cancel();
+    for (RenderJobOpenGl* job : m_workerPool.busyJobs())
+        job->cancel();
+}
+
+void MovieRenderer::setSkippedFrames(int skippedFrames)
+{
+    if (m_skippedFrames == skippedFrames)
+        return;
+    m_skippedFrames = skippedFrames;
+    emit skippedFramesChanged(skippedFrames);
+}
+
+bool MovieRenderer::deduplicateFrames() const { return m_deduplicateFrames; }
+
+void MovieRenderer::setDeduplicateFrames(bool deduplicateFrames)
+{
+    if (m_deduplicateFrames == deduplicateFrames)
+        return;
+    m_deduplicateFrames = deduplicateFrames;
+    emit deduplicateFramesChanged(deduplicateFrames);
+}
+
+qreal MovieRenderer::variantsPerMinute() const { return m_variantsPerMinute; }
+
+bool MovieRenderer::profiling() const { return FrameProfiler::isEnabled(); }
+
+void MovieRenderer::setProfiling(bool profiling)
+{
+    if (FrameProfiler::isEnabled() == profiling)
+        return;
+    FrameProfiler::setEnabled(profiling);
+    emit profilingChanged(profiling);
+}
+
+int MovieRenderer::workerIdleTimeout() const { return m_workerIdleTimeout; }
+
+void MovieRenderer::setWorkerIdleTimeout(int workerIdleTimeout)
+{
+    if (m_workerIdleTimeout == workerIdleTimeout)
+        return;
+    m_workerIdleTimeout = workerIdleTimeout;
+    m_workerPool.setIdleTimeout(workerIdleTimeout);
+    startThreadedJobIdleTimer();
+    emit workerIdleTimeoutChanged(workerIdleTimeout);
+}
+
+void MovieRenderer::startThreadedJobIdleTimer()
+{
+    // Also runs the timer out right away for a timeout of 0, the job is not deleted from its own signal.
+    m_threadedJobIdleTimer.stop();
+    if (m_renderJobOpenGlThreaded && !m_renderJobOpenGlThreaded->isRunning() && m_workerIdleTimeout >= 0)
+        m_threadedJobIdleTimer.start(m_workerIdleTimeout);
 }
 
 // bool MovieRenderer::isRunning() { return m_status == Status::Running; }
@@ -4,6 +4,7 @@
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QEvent>
 #include <QFuture>
 #include <QObject>
@@ -31,16 +32,56 @@
 
 #include "RenderJobOpenGl.h"
 #include "RenderJobOpenGlThreaded.h"
+#include "RenderJobSoftware.h"
+#include "RenderMetrics.h"
+#include "RenderWorkerPool.h"
 
 class MovieRenderer
     : public QObject {
     Q_OBJECT
     Q_PROPERTY(int progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(int fileProgress READ fileProgress NOTIFY fileProgressChanged)
+    Q_PROPERTY(int encoderThreads READ encoderThreads WRITE setEncoderThreads NOTIFY encoderThreadsChanged)
+    Q_PROPERTY(int encoderQueueDepth READ encoderQueueDepth WRITE setEncoderQueueDepth NOTIFY encoderQueueDepthChanged)
+    Q_PROPERTY(bool asyncReadback READ asyncReadback WRITE setAsyncReadback NOTIFY asyncReadbackChanged)
+    Q_PROPERTY(int readbackBufferCount READ readbackBufferCount WRITE setReadbackBufferCount NOTIFY readbackBufferCountChanged)
+    Q_PROPERTY(int startFrame READ startFrame WRITE setStartFrame NOTIFY startFrameChanged)
+    Q_PROPERTY(int endFrame READ endFrame WRITE setEndFrame NOTIFY endFrameChanged)
+    Q_PROPERTY(int instanceCount READ instanceCount WRITE setInstanceCount NOTIFY instanceCountChanged)
+    Q_PROPERTY(QString streamCommand READ streamCommand WRITE setStreamCommand NOTIFY streamCommandChanged)
+    Q_PROPERTY(bool gpuYuvConversion READ gpuYuvConversion WRITE setGpuYuvConversion NOTIFY gpuYuvConversionChanged)
+    Q_PROPERTY(bool yuvFullRange READ yuvFullRange WRITE setYuvFullRange NOTIFY yuvFullRangeChanged)
+    Q_PROPERTY(bool skipUnchangedFrames READ skipUnchangedFrames WRITE setSkipUnchangedFrames NOTIFY skipUnchangedFramesChanged)
+    Q_PROPERTY(int skippedFrames READ skippedFrames NOTIFY skippedFramesChanged)
+    Q_PROPERTY(qreal variantsPerMinute READ variantsPerMinute NOTIFY variantsPerMinuteChanged)
+    Q_PROPERTY(qreal renderFps READ renderFps NOTIFY metricsChanged)
+    Q_PROPERTY(qreal encodeFps READ encodeFps NOTIFY metricsChanged)
+    Q_PROPERTY(qint64 queuedFrames READ queuedFrames NOTIFY metricsChanged)
+    Q_PROPERTY(qint64 bytesWritten READ bytesWritten NOTIFY metricsChanged)
+    Q_PROPERTY(qreal eta READ eta NOTIFY metricsChanged)
+    Q_PROPERTY(qint64 peakMemory READ peakMemory NOTIFY metricsChanged)
+    Q_PROPERTY(bool profiling READ profiling WRITE setProfiling NOTIFY profilingChanged)
+    Q_PROPERTY(int workerIdleTimeout READ workerIdleTimeout WRITE setWorkerIdleTimeout NOTIFY workerIdleTimeoutChanged)
+    Q_PROPERTY(bool deduplicateFrames READ deduplicateFrames WRITE setDeduplicateFrames NOTIFY deduplicateFramesChanged)
+    Q_PROPERTY(bool paused READ paused WRITE setPaused NOTIFY pausedChanged)
+    Q_PROPERTY(bool softwareRendering READ softwareRendering WRITE setSoftwareRendering NOTIFY softwareRenderingChanged)
+    Q_PROPERTY(int tileSize READ tileSize WRITE setTileSize NOTIFY tileSizeChanged)
+    Q_PROPERTY(int samples READ samples WRITE setSamples NOTIFY samplesChanged)
+    Q_PROPERTY(int supersample READ supersample WRITE setSupersample NOTIFY supersampleChanged)
+    Q_PROPERTY(int motionBlurSamples READ motionBlurSamples WRITE setMotionBlurSamples NOTIFY motionBlurSamplesChanged)
+    Q_PROPERTY(QStringList renditions READ renditions WRITE setRenditions NOTIFY renditionsChanged)
     QML_ELEMENT
 
 public:
     explicit MovieRenderer(QObject* parent = 0);
 
+    // Chooses the scene graph backend of the whole process, once and before
+    // the first QQuickWindow: software for RenderJobSoftware, OpenGL for the
+    // other jobs. The jobs only check it, a process renders with one of them.
+    static void selectGraphicsApi(bool software);
+
+    // outputFormat may carry image options, "png?level=1&filter=up" or
+    // "jpg?quality=90", see ImageEncoder.
     Q_INVOKABLE void renderMovie(
         const QString& qmlFile,
         const QString& filename,
@@ -49,29 +90,240 @@ public:
         const QSize& size,
         const qreal devicePixelRatio = 1.0,
         const int durationMs = 1000,
-        const int fps = 24);
+        const qreal fps = 24);
+
+    // Renders qmlFile once per entry of variants, a list of property maps that
+    // are set on the root item with createWithInitialProperties(). Output files
+    // are named <filename>_<variant index>_<frame>. Up to instanceCount variants
+    // render in parallel on pooled workers that keep the compiled component.
+    Q_INVOKABLE void renderVariants(
+        const QString& qmlFile,
+        const QString& filename,
+        const QVariantList& variants,
+        const QString& outputDirectory,
+        const QString& outputFormat,
+        const QSize& size,
+        const qreal devicePixelRatio = 1.0,
+        const int durationMs = 1000,
+        const qreal fps = 24);
+    // Reads variants from a JSON array of objects or a CSV file with a header row.
+    Q_INVOKABLE static QVariantList loadVariants(const QString& fileName);
+    // Stops all running jobs before their next frame. Frames already rendered
+    // are still written, finished() follows once the jobs cleaned up.
+    Q_INVOKABLE void cancel();
 
     int progress() const;
-    bool event(QEvent* event) override;
+    int fileProgress() const;
+    int encoderThreads() const;
+    void setEncoderThreads(int encoderThreads);
+    int encoderQueueDepth() const;
+    void setEncoderQueueDepth(int encoderQueueDepth);
+    bool asyncReadback() const;
+    void setAsyncReadback(bool asyncReadback);
+    int readbackBufferCount() const;
+    void setReadbackBufferCount(int readbackBufferCount);
+    int startFrame() const;
+    void setStartFrame(int startFrame);
+    int endFrame() const;
+    void setEndFrame(int endFrame);
+    int instanceCount() const;
+    void setInstanceCount(int instanceCount);
+    QString streamCommand() const;
+    void setStreamCommand(const QString& streamCommand);
+    bool gpuYuvConversion() const;
+    void setGpuYuvConversion(bool gpuYuvConversion);
+    bool yuvFullRange() const;
+    void setYuvFullRange(bool yuvFullRange);
+    bool skipUnchangedFrames() const;
+    void setSkipUnchangedFrames(bool skipUnchangedFrames);
+    int skippedFrames() const;
+    bool deduplicateFrames() const;
+    qreal variantsPerMinute() const;
+    // Live metrics of the running render, sampled every metricsInterval ms.
+    qreal renderFps() const { return m_renderFps; }
+    qreal encodeFps() const { return m_encodeFps; }
+    // Frames waiting for or in the encoders
+    qint64 queuedFrames() const { return m_queuedFrames; }
+    qint64 bytesWritten() const { return m_bytesWritten; }
+    // Seconds until all frames are encoded, -1 while unknown
+    qreal eta() const { return m_eta; }
+    // Peak resident memory of the process in bytes
+    qint64 peakMemory() const { return m_peakMemory; }
+
+    // Per stage frame timings, each job writes <name>.trace.json and logs p50/p95/p99.
+    // Takes effect immediately, also for running jobs.
+    bool profiling() const;
+    void setProfiling(bool profiling);
+    // Render jobs stay initialized for this many ms after a job, 0 disables
+    // reuse and a negative timeout keeps them until the renderer is destroyed.
+    int workerIdleTimeout() const;
+    void setWorkerIdleTimeout(int workerIdleTimeout);
+    void setDeduplicateFrames(bool deduplicateFrames);
+    // Holds all running jobs between frames, the encoders still drain.
+    bool paused() const;
+    void setPaused(bool paused);
+    // Render with RenderJobSoftware, needs the software scene graph backend
+    // from selectGraphicsApi(true).
+    bool softwareRendering() const;
+    void setSoftwareRendering(bool softwareRendering);
+    // Renders frames in tiles of this many device pixels and streams them to
+    // pam, ppm, rgba or y4m output. 0 only tiles frames larger than the
+    // maximum fbo size. Pooled OpenGL jobs only.
+    int tileSize() const;
+    void setTileSize(int tileSize);
+    // Antialiasing of the OpenGL jobs: MSAA samples (0 is off) and a
+    // supersampling factor that is downsampled on the GPU before readback.
+    int samples() const;
+    void setSamples(int samples);
+    int supersample() const;
+    void setSupersample(int supersample);
+    // Sub-frames averaged on the GPU into each frame for motion blur, 1 is
+    // off. Pooled OpenGL jobs only.
+    int motionBlurSamples() const;
+    void setMotionBlurSamples(int motionBlurSamples);
+    // Smaller outputs scaled on the GPU from the same render, as
+    // "<width>x<height>[:<format>]" in pixels. Pooled OpenGL jobs only.
+    QStringList renditions() const;
+    void setRenditions(const QStringList& renditions);
     // bool isRunning();
 
 signals:
     void progressChanged(int progress);
     void finished();
     void fileProgressChanged(int fileProgress);
+    void encoderThreadsChanged(int encoderThreads);
+    void encoderQueueDepthChanged(int encoderQueueDepth);
+    void asyncReadbackChanged(bool asyncReadback);
+    void readbackBufferCountChanged(int readbackBufferCount);
+    void startFrameChanged(int startFrame);
+    void endFrameChanged(int endFrame);
+    void instanceCountChanged(int instanceCount);
+    void streamCommandChanged(const QString& streamCommand);
+    void gpuYuvConversionChanged(bool gpuYuvConversion);
+    void yuvFullRangeChanged(bool yuvFullRange);
+    void skipUnchangedFramesChanged(bool skipUnchangedFrames);
+    void skippedFramesChanged(int skippedFrames);
+    void deduplicateFramesChanged(bool deduplicateFrames);
+    void pausedChanged(bool paused);
+    void softwareRenderingChanged(bool softwareRendering);
+    void tileSizeChanged(int tileSize);
+    void samplesChanged(int samples);
+    void supersampleChanged(int supersample);
+    void motionBlurSamplesChanged(int motionBlurSamples);
+    void renditionsChanged(const QStringList& renditions);
+    void workerIdleTimeoutChanged(int workerIdleTimeout);
+    void profilingChanged(bool profiling);
+    void metricsChanged();
+    void variantsPerMinuteChanged(qreal variantsPerMinute);
     void startRenderJob();
 
 private slots:
     void setProgress(int progress);
-    void futureFinished();
+    void setFileProgress(int fileProgress);
+    void setSkippedFrames(int skippedFrames);
 
 private:
+    template <typename Job>
+    void configureJob(
+        Job* job,
+        const QString& qmlFile,
+        const QString& filename,
+        const QString& outputDirectory,
+        const QString& outputFormat,
+        const QSize& size,
+        const qreal devicePixelRatio,
+        const int durationMs,
+        const qreal fps);
+    void renderSharded(
+        const QString& qmlFile,
+        const QString& filename,
+        const QString& outputDirectory,
+        const QString& outputFormat,
+        const QSize& size,
+        const qreal devicePixelRatio,
+        const int durationMs,
+        const qreal fps,
+        const int instanceCount);
+    void updateShardProgress();
+    int rangeFrames(const int durationMs, const qreal fps) const;
+    void startMetrics(qint64 totalFrames);
+    void updateMetrics();
+    void renderNextVariant();
+    // Deletes the idle threaded job after workerIdleTimeout
+    void startThreadedJobIdleTimer();
+
+private:
+    // One independent RenderJobOpenGl per frame range, each on its own pooled thread
+    struct Shard {
+        int frames = 0;
+        int progress = 0;
+        int fileProgress = 0;
+        int skippedFrames = 0;
+    };
+
     // Status m_status = Status::NotRunning;
-    int m_progress;
-    QVector<QFutureWatcher<void>*> m_futures;
-    int m_futureCounter;
+    int m_progress = 0;
     int m_fileProgress = 0;
+    int m_encoderThreads = QThread::idealThreadCount();
+    int m_encoderQueueDepth = 2 * QThread::idealThreadCount();
+    bool m_asyncReadback = true;
+    int m_readbackBufferCount = 2;
+    int m_startFrame = 0;
+    int m_endFrame = -1;
+    int m_instanceCount = 1;
+    QString m_streamCommand;
+    bool m_gpuYuvConversion = false;
+    bool m_yuvFullRange = false;
+    bool m_skipUnchangedFrames = false;
+    int m_skippedFrames = 0;
+    bool m_deduplicateFrames = false;
+    int m_workerIdleTimeout = 30000;
+    bool m_paused = false;
+    bool m_cancelled = false;
+    bool m_softwareRendering = false;
+    int m_tileSize = 0;
+    int m_samples = 0;
+    int m_supersample = 1;
+    int m_motionBlurSamples = 1;
+    QStringList m_renditions;
+
+    // Parameters of the running renderVariants() call
+    struct VariantBatch {
+        QString qmlFile;
+        QString filename;
+        QVariantList variants;
+        QString outputDirectory;
+        QString outputFormat;
+        QSize size;
+        qreal devicePixelRatio = 1.0;
+        int durationMs = 0;
+        qreal fps = 0;
+        int next = 0;
+        int running = 0;
+        int finished = 0;
+        QElapsedTimer timer;
+    };
+    VariantBatch m_variantBatch;
+
+    static constexpr int metricsInterval = 500;
+    RenderMetrics m_metrics;
+    QTimer m_metricsTimer;
+    QElapsedTimer m_metricsClock;
+    qint64 m_lastRenderedFrames = 0;
+    qint64 m_lastEncodedFrames = 0;
+    qreal m_renderFps = 0;
+    qreal m_encodeFps = 0;
+    qint64 m_queuedFrames = 0;
+    qint64 m_bytesWritten = 0;
+    qreal m_eta = -1;
+    qint64 m_peakMemory = 0;
+    qreal m_variantsPerMinute = 0;
+    RenderWorkerPool m_workerPool;
+    QTimer m_threadedJobIdleTimer;
+    QVector<Shard> m_shards;
+    int m_runningShards = 0;
     QThread* m_renderThread = nullptr;
     std::unique_ptr<RenderJobOpenGl> m_renderJobOpenGl;
     std::unique_ptr<RenderJobOpenGlThreaded> m_renderJobOpenGlThreaded;
+    std::unique_ptr<RenderJobSoftware> m_renderJobSoftware;
 };